@@ -18,5 +18,7 @@ LIBS += \
 HEADERS += \
     socketwrapper.h \
     mocks.h \
+    fakes.h \
+    deadline.h \
     isocketwrapper.h \
     igui.h
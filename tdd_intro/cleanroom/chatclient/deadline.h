@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+/*
+ * Point in time computed from ITime, after which a blocking socket call gives up.
+ * Default constructed deadline never expires.
+ * Clock types and the time source are nested, so that clients of the socket interface
+ * don't get generic names at global scope.
+*/
+class Deadline
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = Clock::duration;
+    using TimePoint = Clock::time_point;
+
+    class ITime
+    {
+    public:
+        virtual ~ITime() {}
+
+        virtual TimePoint GetCurrent() = 0;
+    };
+
+    class SystemTime : public ITime
+    {
+    public:
+        TimePoint GetCurrent() override
+        {
+            return Clock::now();
+        }
+    };
+
+    Deadline()
+        : m_time(nullptr)
+    {}
+
+    Deadline(ITime& time, Duration timeout)
+        : m_time(&time), m_point(time.GetCurrent() + timeout)
+    {}
+
+    bool IsNever() const
+    {
+        return m_time == nullptr;
+    }
+
+    bool IsExpired() const
+    {
+        return !IsNever() && m_time->GetCurrent() >= m_point;
+    }
+
+    Duration TimeLeft() const
+    {
+        if (IsNever())
+        {
+            return Duration::max();
+        }
+        return std::max(m_point - m_time->GetCurrent(), Duration::zero());
+    }
+
+    // Timeout argument for poll: -1 to wait forever, otherwise milliseconds rounded up,
+    // so that poll does not return before the deadline
+    int PollTimeout() const
+    {
+        if (IsNever())
+        {
+            return -1;
+        }
+        const Duration left = TimeLeft();
+        const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(left + std::chrono::milliseconds(1) - Duration(1));
+        return static_cast<int>(std::min<std::chrono::milliseconds::rep>(milliseconds.count(), std::numeric_limits<int>::max()));
+    }
+
+private:
+    ITime* m_time;
+    TimePoint m_point;
+};
+
+// Calls poll(timeout) until it reports readiness or an error, or the deadline expires.
+// Returns the last result of poll: positive when ready, 0 on timeout, negative on error.
+template <typename Poll>
+int WaitForDeadline(const Deadline& deadline, Poll poll)
+{
+    while (true)
+    {
+        const int result = poll(deadline.PollTimeout());
+        if (result != 0 || deadline.IsExpired())
+        {
+            return result;
+        }
+    }
+}
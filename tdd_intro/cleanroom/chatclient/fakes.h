@@ -0,0 +1,119 @@
+#pragma once
+#include <deque>
+#include <stdexcept>
+#include "isocketwrapper.h"
+
+class FakeTime : public Deadline::ITime
+{
+public:
+    Deadline::TimePoint GetCurrent() override { return m_current; }
+
+    void Wait(Deadline::Duration duration) { m_current += duration; }
+
+private:
+    Deadline::TimePoint m_current;
+};
+
+/*
+ * Socket of a peer which sends messages and connects at given times.
+ * Waiting calls act as poll: they move the fake time till the next event or the timeout.
+*/
+class FakeSocket : public ISocketWrapper
+{
+public:
+    explicit FakeSocket(FakeTime& time)
+        : m_time(time)
+    {}
+
+    // Message to read or connection to accept, which arrives after the given time from now
+    void Arrive(Deadline::Duration after, const std::string& data = std::string())
+    {
+        m_events.push_back(Event{m_time.GetCurrent() + after, data});
+    }
+
+    const std::string& Written() const { return m_written; }
+
+    void Bind(const std::string&, int16_t) override {}
+    void Listen() override {}
+
+    ISocketWrapperPtr Accept() override
+    {
+        return Accept(Deadline());
+    }
+
+    ISocketWrapperPtr Accept(const Deadline& deadline) override
+    {
+        WaitForEvent(deadline, "Timed out waiting for client.");
+        m_events.pop_front();
+        return std::make_shared<FakeSocket>(m_time);
+    }
+
+    ISocketWrapperPtr Connect(const std::string& addr, int16_t port) override
+    {
+        return Connect(addr, port, Deadline());
+    }
+
+    ISocketWrapperPtr Connect(const std::string&, int16_t, const Deadline& deadline) override
+    {
+        WaitForEvent(deadline, "Timed out connecting to server.");
+        m_events.pop_front();
+        return nullptr;
+    }
+
+    void Read(std::string& buffer) override
+    {
+        Read(buffer, Deadline());
+    }
+
+    void Read(std::string& buffer, const Deadline& deadline) override
+    {
+        WaitForEvent(deadline, "Timed out waiting for data.");
+        buffer = m_events.front().data;
+        m_events.pop_front();
+    }
+
+    void Write(const std::string& buffer) override
+    {
+        m_written += buffer;
+    }
+
+private:
+    struct Event
+    {
+        Deadline::TimePoint point;
+        std::string data;
+    };
+
+    int Poll(int timeout)
+    {
+        const Deadline::TimePoint now = m_time.GetCurrent();
+        if (!m_events.empty() && m_events.front().point <= now)
+        {
+            return 1;
+        }
+        if (timeout < 0 && m_events.empty())
+        {
+            throw std::logic_error("Fake socket would block forever.");
+        }
+        if (!m_events.empty() && (timeout < 0 || m_events.front().point - now <= std::chrono::milliseconds(timeout)))
+        {
+            m_time.Wait(m_events.front().point - now);
+            return 1;
+        }
+        m_time.Wait(std::chrono::milliseconds(timeout));
+        return 0;
+    }
+
+    void WaitForEvent(const Deadline& deadline, const char* timeoutMessage)
+    {
+        if (WaitForDeadline(deadline, [this](int timeout) { return Poll(timeout); }) == 0)
+        {
+            throw SocketTimeoutError(timeoutMessage);
+        }
+    }
+
+private:
+    FakeTime& m_time;
+    std::deque<Event> m_events;
+    std::string m_written;
+};
@@ -2,6 +2,8 @@
 #include <memory>
 #include <string>
 #include <cstdint>
+#include <stdexcept>
+#include "deadline.h"
 
 class ISocketWrapper;
 using ISocketWrapperPtr = std::shared_ptr<ISocketWrapper>;
@@ -14,8 +16,17 @@ using ISocketWrapperPtr = std::shared_ptr<ISocketWrapper>;
  * To create a listener (SERVER), use Bind -> Listen -> Accept
  * To create a CLIENT, use Connect
  * See SocketWrapperTest for example of its usage.
+ *
+ * Accept, Connect and Read have variants with a deadline, they throw SocketTimeoutError
+ * when the socket is not ready before the deadline, so a stuck peer costs a bounded time.
 */
 
+class SocketTimeoutError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
 class ISocketWrapper
 {
 public:
@@ -27,10 +38,14 @@ public:
     // Note, that the original socket stays in the same state as before Accept is called.
     // The returned socket is actually the right thing you need to send or receive data within the established connection.
     virtual ISocketWrapperPtr Accept() = 0;
+    virtual ISocketWrapperPtr Accept(const Deadline& deadline) = 0;
     // Connects the socket to the binded port on specified address.
     virtual ISocketWrapperPtr Connect(const std::string& addr, int16_t port)= 0;
+    // Gives up with SocketTimeoutError after the deadline. Returns nullptr: the caller keeps using this socket.
+    virtual ISocketWrapperPtr Connect(const std::string& addr, int16_t port, const Deadline& deadline) = 0;
     // Reads all available data from the stream of established connection.
     virtual void Read(std::string& buffer)= 0;
+    virtual void Read(std::string& buffer, const Deadline& deadline) = 0;
     // Writes data to the stream of established connection.
     // Note, that this function succeeds when write operation is done:
     // it doesn't check whether the data was successfully received on the other side.
@@ -9,8 +9,11 @@ public:
     MOCK_METHOD2(Bind, void(const std::string& addr, int16_t port));
     MOCK_METHOD0(Listen, void());
     MOCK_METHOD0(Accept, ISocketWrapperPtr());
+    MOCK_METHOD1(Accept, ISocketWrapperPtr(const Deadline& deadline));
     MOCK_METHOD2(Connect, ISocketWrapperPtr(const std::string& addr, int16_t port));
+    MOCK_METHOD3(Connect, ISocketWrapperPtr(const std::string& addr, int16_t port, const Deadline& deadline));
     MOCK_METHOD1(Read, void(std::string& buffer));
+    MOCK_METHOD2(Read, void(std::string& buffer, const Deadline& deadline));
     MOCK_METHOD1(Write, void(const std::string& buffer));
 };
 
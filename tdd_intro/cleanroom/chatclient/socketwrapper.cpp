@@ -103,6 +103,12 @@ ISocketWrapperPtr SocketWrapper::Accept()
     return ISocketWrapperPtr(new SocketWrapper(other));
 }
 
+ISocketWrapperPtr SocketWrapper::Accept(const Deadline& deadline)
+{
+    WaitFor(POLLRDNORM, deadline, "Timed out waiting for client.");
+    return Accept();
+}
+
 ISocketWrapperPtr SocketWrapper::Connect(const std::string& addr, int16_t port)
 {
     sockaddr_in addres;
@@ -117,6 +123,48 @@ ISocketWrapperPtr SocketWrapper::Connect(const std::string& addr, int16_t port)
     return ISocketWrapperPtr(new SocketWrapper(other));
 }
 
+// Connection is started in non-blocking mode and waited for till the deadline
+ISocketWrapperPtr SocketWrapper::Connect(const std::string& addr, int16_t port, const Deadline& deadline)
+{
+    sockaddr_in addres;
+    addres.sin_family = AF_INET;
+    addres.sin_addr.s_addr = inet_addr(addr.data());
+    addres.sin_port = htons(port);
+    SetBlocking(false);
+    if (connect(m_socket, reinterpret_cast<sockaddr*>(&addres), sizeof(addres)) == SOCKET_ERROR)
+    {
+        const int error = WSAGetLastError();
+        if (error != WSAEWOULDBLOCK)
+        {
+            SetBlocking(true);
+            throw std::runtime_error(GetExceptionString("Failed to connect to server.", error));
+        }
+        try
+        {
+            WaitForConnect(deadline);
+        }
+        catch (...)
+        {
+            SetBlocking(true);
+            throw;
+        }
+    }
+    SetBlocking(true);
+
+    int error = 0;
+    int errorSize = sizeof(error);
+    if (getsockopt(m_socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &errorSize) == SOCKET_ERROR)
+    {
+        throw std::runtime_error(GetExceptionString("Failed to connect to server.", WSAGetLastError()));
+    }
+    if (error != 0)
+    {
+        throw std::runtime_error(GetExceptionString("Failed to connect to server.", error));
+    }
+    // The connection is established on this socket, there is no other socket to own
+    return nullptr;
+}
+
 void SocketWrapper::Read(std::string& buffer)
 {
     std::vector<char> bufferTmp(1024); // 1KB
@@ -128,6 +176,12 @@ void SocketWrapper::Read(std::string& buffer)
     buffer.assign(bufferTmp.begin(), bufferTmp.begin() + portionReceived);
 }
 
+void SocketWrapper::Read(std::string& buffer, const Deadline& deadline)
+{
+    WaitFor(POLLRDNORM, deadline, "Timed out waiting for data.");
+    Read(buffer);
+}
+
 void SocketWrapper::Write(const std::string& buffer)
 {
     for (int dataSent = 0; dataSent < buffer.size();)
@@ -139,3 +193,58 @@ void SocketWrapper::Write(const std::string& buffer)
         }
     }
 }
+
+void SocketWrapper::SetBlocking(bool blocking)
+{
+    u_long nonBlocking = blocking ? 0 : 1;
+    if (ioctlsocket(m_socket, FIONBIO, &nonBlocking) == SOCKET_ERROR)
+    {
+        throw std::runtime_error(GetExceptionString("Failed to change blocking mode.", WSAGetLastError()));
+    }
+}
+
+// Errors and hang ups count as readiness, the following call reports them
+void SocketWrapper::WaitFor(short events, const Deadline& deadline, const char* timeoutMessage)
+{
+    WSAPOLLFD descriptor = {};
+    descriptor.fd = m_socket;
+    descriptor.events = events;
+    const int result = WaitForDeadline(deadline, [&descriptor](int timeout)
+    {
+        descriptor.revents = 0;
+        return WSAPoll(&descriptor, 1, timeout);
+    });
+    if (SOCKET_ERROR == result)
+    {
+        throw std::runtime_error(GetExceptionString("Failed to poll socket.", WSAGetLastError()));
+    }
+    if (result == 0)
+    {
+        throw SocketTimeoutError(timeoutMessage);
+    }
+}
+
+// WSAPoll doesn't report failed connects before Windows 10 2004, select reports them in the except set.
+// The error itself is read from SO_ERROR afterwards.
+void SocketWrapper::WaitForConnect(const Deadline& deadline)
+{
+    const int result = WaitForDeadline(deadline, [this](int timeout)
+    {
+        fd_set writeSet;
+        fd_set exceptSet;
+        FD_ZERO(&writeSet);
+        FD_ZERO(&exceptSet);
+        FD_SET(m_socket, &writeSet);
+        FD_SET(m_socket, &exceptSet);
+        timeval wait = {timeout / 1000, (timeout % 1000) * 1000};
+        return select(0, nullptr, &writeSet, &exceptSet, timeout < 0 ? nullptr : &wait);
+    });
+    if (SOCKET_ERROR == result)
+    {
+        throw std::runtime_error(GetExceptionString("Failed to wait for connection.", WSAGetLastError()));
+    }
+    if (result == 0)
+    {
+        throw SocketTimeoutError("Timed out connecting to server.");
+    }
+}
@@ -11,10 +11,18 @@ public:
     void Bind(const std::string& addr, int16_t port);
     void Listen();
     ISocketWrapperPtr Accept();
+    ISocketWrapperPtr Accept(const Deadline& deadline);
     ISocketWrapperPtr Connect(const std::string& addr, int16_t port);
+    ISocketWrapperPtr Connect(const std::string& addr, int16_t port, const Deadline& deadline);
     void Read(std::string& buffer);
+    void Read(std::string& buffer, const Deadline& deadline);
     void Write(const std::string& buffer);
 
+private:
+    void SetBlocking(bool blocking);
+    void WaitFor(short events, const Deadline& deadline, const char* timeoutMessage);
+    void WaitForConnect(const Deadline& deadline);
+
 private:
     SOCKET m_socket;
 };
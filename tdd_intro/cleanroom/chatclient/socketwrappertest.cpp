@@ -1,5 +1,6 @@
 // Tests for the real SocketWrapper implementation for Windows.
 #include <gtest/gtest.h>
+#include <iostream>
 #include "socketwrapper.h"
 
 TEST(SocketWrapperTest, EstablishConnection)
@@ -25,3 +26,88 @@ TEST(SocketWrapperTest, EstablishConnection)
 
     EXPECT_STREQ(testPhrase, str.c_str());
 }
+
+TEST(SocketWrapperTest, ReadTimesOut)
+{
+    SocketWrapper listener;
+    SocketWrapper client;
+    const char* address = "127.0.0.1";
+    const int port = 4445;
+
+    listener.Bind(address, port);
+    listener.Listen();
+    client.Connect(address, port);
+    auto server = listener.Accept();
+
+    Deadline::SystemTime time;
+    std::string str;
+    const auto begin = Deadline::Clock::now();
+    EXPECT_THROW(server->Read(str, Deadline(time, std::chrono::milliseconds(100))), SocketTimeoutError);
+    EXPECT_LE(std::chrono::milliseconds(100), Deadline::Clock::now() - begin);
+}
+
+TEST(SocketWrapperTest, AcceptTimesOut)
+{
+    SocketWrapper listener;
+    listener.Bind("127.0.0.1", 4446);
+    listener.Listen();
+
+    Deadline::SystemTime time;
+    EXPECT_THROW(listener.Accept(Deadline(time, std::chrono::milliseconds(100))), SocketTimeoutError);
+}
+
+TEST(SocketWrapperTest, ReadWithDeadline)
+{
+    SocketWrapper listener;
+    SocketWrapper client;
+    const char* address = "127.0.0.1";
+    const int port = 4447;
+
+    listener.Bind(address, port);
+    listener.Listen();
+    Deadline::SystemTime time;
+    EXPECT_EQ(nullptr, client.Connect(address, port, Deadline(time, std::chrono::seconds(5))));
+    auto server = listener.Accept(Deadline(time, std::chrono::seconds(5)));
+
+    server->Write("bla-bla-bla");
+    std::string str;
+    client.Read(str, Deadline(time, std::chrono::seconds(5)));
+    EXPECT_EQ("bla-bla-bla", str);
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(SocketWrapperTest, DISABLED_DeadlineOverhead)
+{
+    SocketWrapper listener;
+    SocketWrapper client;
+    const char* address = "127.0.0.1";
+    const int port = 4448;
+
+    listener.Bind(address, port);
+    listener.Listen();
+    client.Connect(address, port);
+    auto server = listener.Accept();
+
+    Deadline::SystemTime time;
+    const int roundTrips = 100000;
+    std::string str;
+    for (int withDeadline = 0; withDeadline < 2; ++withDeadline)
+    {
+        const auto begin = Deadline::Clock::now();
+        for (int i = 0; i < roundTrips; ++i)
+        {
+            client.Write("x");
+            if (withDeadline)
+            {
+                server->Read(str, Deadline(time, std::chrono::seconds(1)));
+            }
+            else
+            {
+                server->Read(str);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(Deadline::Clock::now() - begin).count();
+        std::cout << (withDeadline ? "with deadline: " : "without deadline: ")
+                  << seconds * 1e9 / roundTrips << " ns per write and read" << std::endl;
+    }
+}
@@ -39,6 +39,7 @@ Implement chat application, that communicates via TCP sockets.
 */
 
 #include "mocks.h"
+#include "fakes.h"
 using namespace ::testing;
 
 bool TryToBind(ISocketWrapper& socket)
@@ -171,3 +172,111 @@ TEST(Chat, ClientHandshakeStart)
     EXPECT_CALL(socket, Write("client:HELLO!")).Times(1);
     ClientHandshake(socket, nickname);
 }
+
+ISocketWrapperPtr EstablishConnection(ISocketWrapper& socket, const Deadline& deadline)
+{
+    if (TryToBind(socket))
+    {
+        socket.Listen();
+        return socket.Accept(deadline);
+    }
+    else
+    {
+        return socket.Connect("", 0, deadline);
+    }
+}
+
+void ReadFromSocket(ISocketWrapper& socket, std::string& data, const Deadline& deadline)
+{
+    socket.Read(data, deadline);
+}
+
+TEST(Deadline, PollTimeout)
+{
+    FakeTime time;
+    ASSERT_EQ(-1, Deadline().PollTimeout());
+    ASSERT_EQ(5000, Deadline(time, std::chrono::seconds(5)).PollTimeout());
+    ASSERT_EQ(2, Deadline(time, std::chrono::microseconds(1500)).PollTimeout());
+    ASSERT_EQ(0, Deadline(time, Deadline::Duration::zero()).PollTimeout());
+    ASSERT_EQ(std::numeric_limits<int>::max(), Deadline(time, std::chrono::hours(24 * 365)).PollTimeout());
+}
+
+TEST(Deadline, Expires)
+{
+    FakeTime time;
+    Deadline deadline(time, std::chrono::seconds(5));
+    time.Wait(std::chrono::seconds(2));
+    ASSERT_FALSE(deadline.IsExpired());
+    ASSERT_EQ(std::chrono::seconds(3), deadline.TimeLeft());
+    time.Wait(std::chrono::seconds(3));
+    ASSERT_TRUE(deadline.IsExpired());
+    ASSERT_EQ(Deadline::Duration::zero(), deadline.TimeLeft());
+    ASSERT_FALSE(Deadline().IsExpired());
+}
+
+TEST(Chat, ReadWithDeadline_DataInTime)
+{
+    FakeTime time;
+    FakeSocket socket(time);
+    socket.Arrive(std::chrono::seconds(1), "Hello");
+    std::string data;
+    ReadFromSocket(socket, data, Deadline(time, std::chrono::seconds(5)));
+    ASSERT_EQ("Hello", data);
+    ASSERT_EQ(std::chrono::seconds(1), time.GetCurrent() - Deadline::TimePoint());
+}
+
+TEST(Chat, ReadWithDeadline_StuckPeer)
+{
+    FakeTime time;
+    FakeSocket socket(time);
+    std::string data;
+    ASSERT_THROW(ReadFromSocket(socket, data, Deadline(time, std::chrono::seconds(5))), SocketTimeoutError);
+    ASSERT_EQ(std::chrono::seconds(5), time.GetCurrent() - Deadline::TimePoint());
+}
+
+TEST(Chat, ReadWithDeadline_DataAfterDeadline)
+{
+    FakeTime time;
+    FakeSocket socket(time);
+    socket.Arrive(std::chrono::seconds(10), "Hello");
+    std::string data;
+    ASSERT_THROW(ReadFromSocket(socket, data, Deadline(time, std::chrono::seconds(5))), SocketTimeoutError);
+    ReadFromSocket(socket, data, Deadline(time, std::chrono::seconds(5)));
+    ASSERT_EQ("Hello", data);
+    ASSERT_EQ(std::chrono::seconds(10), time.GetCurrent() - Deadline::TimePoint());
+}
+
+TEST(Chat, ReadWithDeadline_NotBeforeDeadline)
+{
+    FakeTime time;
+    FakeSocket socket(time);
+    std::string data;
+    ASSERT_THROW(ReadFromSocket(socket, data, Deadline(time, std::chrono::microseconds(1500))), SocketTimeoutError);
+    ASSERT_LE(std::chrono::microseconds(1500), time.GetCurrent() - Deadline::TimePoint());
+}
+
+TEST(Chat, AcceptWithDeadline_NoClient)
+{
+    FakeTime time;
+    FakeSocket listener(time);
+    ASSERT_THROW(EstablishConnection(listener, Deadline(time, std::chrono::seconds(30))), SocketTimeoutError);
+    ASSERT_EQ(std::chrono::seconds(30), time.GetCurrent() - Deadline::TimePoint());
+}
+
+TEST(Chat, AcceptWithDeadline_ClientConnects)
+{
+    FakeTime time;
+    FakeSocket listener(time);
+    listener.Arrive(std::chrono::seconds(3));
+    ASSERT_NE(nullptr, EstablishConnection(listener, Deadline(time, std::chrono::seconds(30))));
+    ASSERT_EQ(std::chrono::seconds(3), time.GetCurrent() - Deadline::TimePoint());
+}
+
+TEST(Chat, ConnectWithDeadline_Mock)
+{
+    SocketWrapperMock client;
+    FakeTime time;
+    EXPECT_CALL(client, Bind(_, _)).WillOnce(Throw(std::runtime_error("")));
+    EXPECT_CALL(client, Connect(_, _, _)).WillOnce(Throw(SocketTimeoutError("")));
+    ASSERT_THROW(EstablishConnection(client, Deadline(time, std::chrono::seconds(1))), SocketTimeoutError);
+}
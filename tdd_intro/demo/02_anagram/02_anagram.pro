@@ -1,7 +1,7 @@
 include(../../gtest.pri)
 
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++17 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
@@ -6,29 +6,533 @@ Given "listen" and a list of candidates like "enlists" "google" "inlets" "banana
 _from http://exercism.io/_
 */
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if !defined(ANAGRAM_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ANAGRAM_SSE2
+#include <emmintrin.h>
+#endif
 
 using Anagrams = std::set<std::string>;
 
-bool IsAnagrams(std::string left, std::string right)
+// Words of equal size are anagrams when the byte histogram of the left word minus the histogram
+// of the right word is zero. Counters wrap around, which is harmless while their bit width exceeds
+// the word size, so words shorter than 256 bytes use 8-bit counters and the whole table is checked
+// by OR-ing it as 32 64-bit words.
+template<typename Counter>
+bool IsZeroTable(const Counter (&counts)[256])
 {
-    if (left == right || left.empty() || right.empty())
+    uint64_t nonZero = 0;
+    for (size_t offset = 0; offset < sizeof(counts); offset += sizeof(uint64_t))
+    {
+        uint64_t chunk;
+        std::memcpy(&chunk, reinterpret_cast<const char*>(counts) + offset, sizeof(chunk));
+        nonZero |= chunk;
+    }
+    return nonZero == 0;
+}
+
+template<typename Counter>
+bool HaveSameLetters(std::string_view left, std::string_view right)
+{
+    Counter counts[256] = {};
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        ++counts[static_cast<unsigned char>(left[i])];
+        --counts[static_cast<unsigned char>(right[i])];
+    }
+    return IsZeroTable(counts);
+}
+
+#ifdef ANAGRAM_SSE2
+// Dictionary words are short ASCII strings, for them clearing and checking 256 counters costs
+// more than counting the letters. ASCII needs only 128 counters which are checked by 8 SSE2 registers.
+// The high bits of all bytes are collected while counting, other words fall back to the full table.
+inline bool HaveSameAsciiLetters(std::string_view left, std::string_view right)
+{
+    alignas(16) uint8_t counts[128] = {};
+    unsigned highBits = 0;
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        const unsigned char leftByte = static_cast<unsigned char>(left[i]);
+        const unsigned char rightByte = static_cast<unsigned char>(right[i]);
+        highBits |= leftByte | rightByte;
+        ++counts[leftByte & 0x7F];
+        --counts[rightByte & 0x7F];
+    }
+    if ((highBits & 0x80) != 0)
+    {
+        return HaveSameLetters<uint8_t>(left, right);
+    }
+
+    const __m128i* table = reinterpret_cast<const __m128i*>(counts);
+    const __m128i nonZero = _mm_or_si128(_mm_or_si128(_mm_or_si128(table[0], table[1]), _mm_or_si128(table[2], table[3])),
+                                         _mm_or_si128(_mm_or_si128(table[4], table[5]), _mm_or_si128(table[6], table[7])));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(nonZero, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+bool IsAnagrams(std::string_view left, std::string_view right)
+{
+    if (left.size() != right.size() || left.empty() || left == right)
     {
         return false;
     }
-    std::sort (left.begin(), left.end());
-    std::sort (right.begin(), right.end());
-    return left == right;
+#ifdef ANAGRAM_SSE2
+    return left.size() < 256 ? HaveSameAsciiLetters(left, right) : HaveSameLetters<uint32_t>(left, right);
+#else
+    return left.size() < 256 ? HaveSameLetters<uint8_t>(left, right) : HaveSameLetters<uint32_t>(left, right);
+#endif
+}
+
+// Anagrams of the word in sorted order without duplicates, same as GetAnagrams but without building a set
+std::vector<std::string> GetAnagramList(const std::string& word, const std::vector<std::string>& candidates)
+{
+    std::vector<std::string> anagrams;
+    std::copy_if(candidates.begin(), candidates.end(), std::back_inserter(anagrams),
+                 [&](const std::string& candidate) {return IsAnagrams(word, candidate);});
+    std::sort(anagrams.begin(), anagrams.end());
+    anagrams.erase(std::unique(anagrams.begin(), anagrams.end()), anagrams.end());
+    return anagrams;
 }
 
 Anagrams GetAnagrams(const std::string& word, const std::vector<std::string>& candidates)
 {
-    Anagrams anagrams;
-    std::copy_if(candidates.begin(), candidates.end(), std::inserter(anagrams, anagrams.end()),
-                         [&](const std::string& candidate) {return IsAnagrams(word, candidate);});
+    const std::vector<std::string> anagrams = GetAnagramList(word, candidates);
+    return Anagrams(anagrams.begin(), anagrams.end());
+}
+
+// Checks candidates against the histogram of the word computed once
+class AnagramMatcher
+{
+public:
+    explicit AnagramMatcher(std::string_view word)
+        : m_word(word), m_smallCounts(), m_counts()
+    {
+        for (char c : word)
+        {
+            ++m_smallCounts[static_cast<unsigned char>(c)];
+            ++m_counts[static_cast<unsigned char>(c)];
+        }
+    }
+
+    // Same as IsAnagrams(word, candidate)
+    bool Matches(std::string_view candidate) const
+    {
+        if (candidate.size() != m_word.size() || candidate.empty() || candidate == m_word)
+        {
+            return false;
+        }
+        return candidate.size() < 256 ? HasSameLetters(m_smallCounts, candidate) : HasSameLetters(m_counts, candidate);
+    }
 
+private:
+    template<typename Counter>
+    static bool HasSameLetters(const Counter (&wordCounts)[256], std::string_view candidate)
+    {
+        Counter counts[256];
+        std::memcpy(counts, wordCounts, sizeof(counts));
+        for (char c : candidate)
+        {
+            --counts[static_cast<unsigned char>(c)];
+        }
+        return IsZeroTable(counts);
+    }
+
+private:
+    std::string_view m_word;
+    uint8_t m_smallCounts[256];
+    uint32_t m_counts[256];
+};
+
+size_t DefaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Same result as GetAnagramList, candidates are filtered in chunks on given number of threads
+std::vector<std::string> GetAnagramListParallel(const std::string& word, const std::vector<std::string>& candidates,
+                                                size_t threadCount = DefaultThreadCount())
+{
+    const AnagramMatcher matcher(word);
+    const size_t chunks = std::max<size_t>(1, std::min(threadCount, candidates.size()));
+    const size_t chunkSize = (candidates.size() + chunks - 1) / chunks;
+    std::vector<std::vector<const std::string*>> matches(chunks);
+
+    auto filter = [&](size_t chunk)
+    {
+        const size_t end = std::min(candidates.size(), (chunk + 1) * chunkSize);
+        for (size_t index = chunk * chunkSize; index < end; ++index)
+        {
+            if (matcher.Matches(candidates[index]))
+            {
+                matches[chunk].push_back(&candidates[index]);
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t chunk = 1; chunk < chunks; ++chunk)
+    {
+        threads.emplace_back(filter, chunk);
+    }
+    filter(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<const std::string*> merged;
+    for (const std::vector<const std::string*>& chunkMatches : matches)
+    {
+        merged.insert(merged.end(), chunkMatches.begin(), chunkMatches.end());
+    }
+    std::sort(merged.begin(), merged.end(), [](const std::string* left, const std::string* right) { return *left < *right; });
+    merged.erase(std::unique(merged.begin(), merged.end(), [](const std::string* left, const std::string* right)
+    {
+        return *left == *right;
+    }), merged.end());
+
+    std::vector<std::string> anagrams;
+    anagrams.reserve(merged.size());
+    for (const std::string* anagram : merged)
+    {
+        anagrams.push_back(*anagram);
+    }
     return anagrams;
 }
 
+/*
+ * AnagramIndex is built once for a fixed dictionary.
+ * Words are grouped by signature - the word with sorted letters, equal for all anagrams.
+ * Dictionary words are stored sorted by (signature, word), so every group is a contiguous
+ * range and the query costs one signature, one hash lookup and a scan of the range.
+*/
+
+std::string AnagramSignature(std::string word)
+{
+    std::sort(word.begin(), word.end());
+    return word;
+}
+
+class AnagramIndex
+{
+public:
+    explicit AnagramIndex(const std::vector<std::string>& dictionary)
+    {
+        std::vector<std::pair<std::string, std::string>> entries;
+        entries.reserve(dictionary.size());
+        for (const std::string& word : dictionary)
+        {
+            if (!word.empty())
+            {
+                entries.emplace_back(AnagramSignature(word), word);
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+        m_words.reserve(entries.size());
+        for (size_t begin = 0; begin < entries.size();)
+        {
+            size_t end = begin;
+            while (end < entries.size() && entries[end].first == entries[begin].first)
+            {
+                m_words.push_back(std::move(entries[end].second));
+                ++end;
+            }
+            m_groups.emplace(std::move(entries[begin].first), Range(begin, end));
+            begin = end;
+        }
+    }
+
+    // Same words as GetAnagrams(word, dictionary) in the same (sorted) order
+    std::vector<std::string> Find(const std::string& word) const
+    {
+        std::vector<std::string> result;
+        auto group = m_groups.find(AnagramSignature(word));
+        if (group == m_groups.end())
+        {
+            return result;
+        }
+        for (size_t index = group->second.first; index < group->second.second; ++index)
+        {
+            if (m_words[index] != word)
+            {
+                result.push_back(m_words[index]);
+            }
+        }
+        return result;
+    }
+
+    // Number of distinct dictionary words
+    size_t Size() const
+    {
+        return m_words.size();
+    }
+
+private:
+    using Range = std::pair<size_t, size_t>;
+
+    std::vector<std::string> m_words;
+    std::unordered_map<std::string, Range> m_groups;
+};
+
+/*
+ * AnagramSearch answers word game queries over a dictionary of words of letters 'a'..'z':
+ *   SubAnagrams - every word which can be formed from the letters of the query
+ *   Phrases - sequences of words which use exactly all letters of the query
+ * Words are grouped by signature as in AnagramIndex, and signatures (sorted letters) are stored
+ * in a trie. Since letters along any trie path are sorted, the search descends only into children
+ * whose letter is still available, which prunes the whole subtree of impossible words at once.
+ * Phrase search works on the groups found by SubAnagrams: after every chosen word the candidate
+ * list is filtered to the groups which still fit into the remaining letters.
+*/
+
+using LetterCounts = std::array<uint8_t, 26>;
+using Phrase = std::vector<std::string>;
+
+class AnagramSearch
+{
+public:
+    explicit AnagramSearch(const std::vector<std::string>& dictionary)
+        : m_nodes(1)
+    {
+        std::unordered_map<std::string, size_t> groupBySignature;
+        for (const std::string& word : dictionary)
+        {
+            if (word.empty() || !std::all_of(word.begin(), word.end(), [](char c) { return c >= 'a' && c <= 'z'; }))
+            {
+                continue;
+            }
+            const std::string signature = AnagramSignature(word);
+            auto inserted = groupBySignature.emplace(signature, m_groups.size());
+            if (inserted.second)
+            {
+                m_groups.push_back({CountLetters(signature), signature.size(), {}});
+                Insert(signature, inserted.first->second);
+            }
+            m_groups[inserted.first->second].words.push_back(word);
+        }
+        for (Group& group : m_groups)
+        {
+            std::sort(group.words.begin(), group.words.end());
+            group.words.erase(std::unique(group.words.begin(), group.words.end()), group.words.end());
+        }
+    }
+
+    // Letters 'a'..'z' of the query, case insensitive, other characters are ignored
+    static LetterCounts CountLetters(std::string_view letters)
+    {
+        LetterCounts counts = {};
+        for (char c : letters)
+        {
+            const char lower = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+            if (lower >= 'a' && lower <= 'z' && counts[lower - 'a'] != UINT8_MAX)
+            {
+                ++counts[lower - 'a'];
+            }
+        }
+        return counts;
+    }
+
+    // Dictionary words formed from the letters, each letter used no more times than given, sorted
+    std::vector<std::string> SubAnagrams(std::string_view letters) const
+    {
+        std::vector<std::string> result;
+        for (size_t group : FindGroups(CountLetters(letters)))
+        {
+            result.insert(result.end(), m_groups[group].words.begin(), m_groups[group].words.end());
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // Up to maxResults phrases of at most maxWords words using exactly all the letters.
+    // Words of a phrase go from the longest to the shortest, every set of words is reported once.
+    std::vector<Phrase> Phrases(std::string_view letters, size_t maxWords, size_t maxResults) const
+    {
+        const LetterCounts counts = CountLetters(letters);
+        std::vector<size_t> candidates = FindGroups(counts);
+        std::stable_sort(candidates.begin(), candidates.end(), [this](size_t left, size_t right)
+        {
+            return m_groups[left].length > m_groups[right].length;
+        });
+
+        PhraseSearch search = {counts, maxWords, maxResults, {}, {}};
+        size_t totalLetters = 0;
+        for (uint8_t count : counts)
+        {
+            totalLetters += count;
+        }
+        if (totalLetters != 0)
+        {
+            SearchPhrases(search, candidates, totalLetters);
+        }
+        return search.result;
+    }
+
+private:
+    struct Group
+    {
+        LetterCounts counts;
+        size_t length;
+        std::vector<std::string> words;
+    };
+
+    struct Node
+    {
+        int32_t group = -1;
+        std::vector<std::pair<uint8_t, uint32_t>> children;
+    };
+
+    struct PhraseSearch
+    {
+        LetterCounts remaining;
+        size_t maxWords;
+        size_t maxResults;
+        std::vector<size_t> groups;
+        std::vector<Phrase> result;
+    };
+
+    void Insert(const std::string& signature, size_t group)
+    {
+        uint32_t node = 0;
+        for (char c : signature)
+        {
+            const uint8_t letter = static_cast<uint8_t>(c - 'a');
+            auto& children = m_nodes[node].children;
+            auto child = std::find_if(children.begin(), children.end(),
+                                      [letter](const std::pair<uint8_t, uint32_t>& edge) { return edge.first == letter; });
+            if (child != children.end())
+            {
+                node = child->second;
+                continue;
+            }
+            const uint32_t next = static_cast<uint32_t>(m_nodes.size());
+            children.emplace_back(letter, next);
+            m_nodes.emplace_back();
+            node = next;
+        }
+        m_nodes[node].group = static_cast<int32_t>(group);
+    }
+
+    std::vector<size_t> FindGroups(LetterCounts counts) const
+    {
+        std::vector<size_t> groups;
+        CollectGroups(0, counts, groups);
+        return groups;
+    }
+
+    void CollectGroups(uint32_t node, LetterCounts& counts, std::vector<size_t>& groups) const
+    {
+        if (m_nodes[node].group >= 0)
+        {
+            groups.push_back(static_cast<size_t>(m_nodes[node].group));
+        }
+        for (const auto& child : m_nodes[node].children)
+        {
+            if (counts[child.first] != 0)
+            {
+                --counts[child.first];
+                CollectGroups(child.second, counts, groups);
+                ++counts[child.first];
+            }
+        }
+    }
+
+    bool Fits(size_t group, const LetterCounts& remaining) const
+    {
+        for (size_t letter = 0; letter < remaining.size(); ++letter)
+        {
+            if (m_groups[group].counts[letter] > remaining[letter])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Candidates are ordered by length, the next word is taken from the current or the following candidates
+    void SearchPhrases(PhraseSearch& search, const std::vector<size_t>& candidates, size_t remainingLetters) const
+    {
+        if (search.groups.size() == search.maxWords || candidates.empty()
+            || remainingLetters > (search.maxWords - search.groups.size()) * m_groups[candidates.front()].length)
+        {
+            return;
+        }
+
+        for (size_t i = 0; i < candidates.size() && search.result.size() < search.maxResults; ++i)
+        {
+            const Group& group = m_groups[candidates[i]];
+            for (size_t letter = 0; letter < search.remaining.size(); ++letter)
+            {
+                search.remaining[letter] -= group.counts[letter];
+            }
+            search.groups.push_back(candidates[i]);
+
+            if (remainingLetters == group.length)
+            {
+                ExpandPhrases(search, 0, 0, Phrase());
+            }
+            else
+            {
+                std::vector<size_t> next;
+                for (size_t j = i; j < candidates.size(); ++j)
+                {
+                    if (Fits(candidates[j], search.remaining))
+                    {
+                        next.push_back(candidates[j]);
+                    }
+                }
+                SearchPhrases(search, next, remainingLetters - group.length);
+            }
+
+            search.groups.pop_back();
+            for (size_t letter = 0; letter < search.remaining.size(); ++letter)
+            {
+                search.remaining[letter] += group.counts[letter];
+            }
+        }
+    }
+
+    // Turns the found sequence of groups into phrases of words.
+    // Repeated group continues from the previous word, so no phrase is reported twice.
+    void ExpandPhrases(PhraseSearch& search, size_t position, size_t firstWord, Phrase phrase) const
+    {
+        if (position == search.groups.size())
+        {
+            search.result.push_back(phrase);
+            return;
+        }
+        const std::vector<std::string>& words = m_groups[search.groups[position]].words;
+        const bool sameGroup = position != 0 && search.groups[position] == search.groups[position - 1];
+        for (size_t word = sameGroup ? firstWord : 0; word < words.size() && search.result.size() < search.maxResults; ++word)
+        {
+            phrase.push_back(words[word]);
+            ExpandPhrases(search, position + 1, word, phrase);
+            phrase.pop_back();
+        }
+    }
+
+private:
+    std::vector<Group> m_groups;
+    std::vector<Node> m_nodes;
+};
+
 TEST (IsAnagrams, empty_words)
 {
     EXPECT_FALSE(IsAnagrams("", ""));
@@ -49,6 +553,38 @@ TEST (IsAnagrams, anagrams_return_true)
     EXPECT_TRUE(IsAnagrams("listen", "inlets"));
 }
 
+TEST (IsAnagrams, different_sizes_return_false)
+{
+    EXPECT_FALSE(IsAnagrams("listen", "enlists"));
+}
+
+TEST (IsAnagrams, same_letters_different_counts_return_false)
+{
+    EXPECT_FALSE(IsAnagrams("aab", "abb"));
+}
+
+TEST (IsAnagrams, long_anagrams_return_true)
+{
+    const std::string left = std::string(300, 'a') + std::string(300, 'b');
+    const std::string right = std::string(300, 'b') + std::string(300, 'a');
+    EXPECT_TRUE(IsAnagrams(left, right));
+}
+
+TEST (IsAnagrams, long_words_difference_multiple_of_256_return_false)
+{
+    const std::string left = std::string(256, 'a') + std::string(256, 'b');
+    const std::string right = std::string(512, 'b');
+    EXPECT_FALSE(IsAnagrams(left, right));
+}
+
+TEST (IsAnagrams, non_ascii_words)
+{
+    EXPECT_TRUE(IsAnagrams("\xC3\xA9t\xC3\xA9", "t\xC3\xA9\xC3\xA9"));
+    // Same low 7 bits as "ab"
+    EXPECT_FALSE(IsAnagrams("ab", "\xE1" "b"));
+    EXPECT_FALSE(IsAnagrams("\xE1" "b", "ba"));
+}
+
 TEST (GetAnagrams, empty_list_empty_word)
 {
     EXPECT_EQ(Anagrams(), GetAnagrams("", std::vector<std::string>()));
@@ -73,3 +609,365 @@ TEST (GetAnagrams, acceptance)
 {
     EXPECT_EQ(Anagrams({"inlets"}), GetAnagrams("listen", {"enlists", "google", "inlets", "banana"}));
 }
+
+TEST (GetAnagramList, sorted_without_duplicates)
+{
+    EXPECT_EQ(std::vector<std::string>({"acb", "cba"}), GetAnagramList("abc", {"cba", "abc", "acb", "cba"}));
+}
+
+TEST (AnagramMatcher, matches_like_IsAnagrams)
+{
+    AnagramMatcher matcher("listen");
+    EXPECT_TRUE(matcher.Matches("inlets"));
+    EXPECT_FALSE(matcher.Matches("listen"));
+    EXPECT_FALSE(matcher.Matches("enlists"));
+    EXPECT_FALSE(matcher.Matches("google"));
+    EXPECT_FALSE(AnagramMatcher("").Matches(""));
+}
+
+TEST (GetAnagramListParallel, empty_list)
+{
+    EXPECT_TRUE(GetAnagramListParallel("abc", {}, 4).empty());
+}
+
+TEST (GetAnagramListParallel, acceptance)
+{
+    EXPECT_EQ(std::vector<std::string>({"inlets"}),
+              GetAnagramListParallel("listen", {"enlists", "google", "inlets", "banana"}, 3));
+}
+
+TEST (GetAnagramListParallel, duplicates_in_different_chunks)
+{
+    EXPECT_EQ(std::vector<std::string>({"acb", "cba"}), GetAnagramListParallel("abc", {"cba", "acb", "cba", "acb"}, 4));
+}
+
+TEST (AnagramIndex, empty_dictionary)
+{
+    AnagramIndex index({});
+    EXPECT_TRUE(index.Find("listen").empty());
+}
+
+TEST (AnagramIndex, empty_word)
+{
+    AnagramIndex index({"", "a"});
+    EXPECT_TRUE(index.Find("").empty());
+}
+
+TEST (AnagramIndex, same_word_is_not_anagram)
+{
+    AnagramIndex index({"word"});
+    EXPECT_TRUE(index.Find("word").empty());
+}
+
+TEST (AnagramIndex, duplicates_are_reported_once)
+{
+    AnagramIndex index({"cba", "acb", "cba"});
+    EXPECT_EQ(2u, index.Size());
+    EXPECT_EQ(std::vector<std::string>({"acb", "cba"}), index.Find("abc"));
+}
+
+TEST (AnagramIndex, acceptance)
+{
+    AnagramIndex index({"enlists", "google", "inlets", "banana"});
+    EXPECT_EQ(std::vector<std::string>({"inlets"}), index.Find("listen"));
+}
+
+TEST (AnagramSearch, sub_anagrams_of_empty_query)
+{
+    AnagramSearch search({"a", "ab"});
+    EXPECT_TRUE(search.SubAnagrams("").empty());
+}
+
+TEST (AnagramSearch, sub_anagrams_use_letters_once)
+{
+    AnagramSearch search({"a", "aa", "ab", "ba", "abc", "b"});
+    EXPECT_EQ(std::vector<std::string>({"a", "ab", "b", "ba"}), search.SubAnagrams("ab"));
+}
+
+TEST (AnagramSearch, sub_anagrams_ignore_case_and_non_letters)
+{
+    AnagramSearch search({"listen", "tin", "Net", "net's", "silent"});
+    EXPECT_EQ(std::vector<std::string>({"listen", "silent", "tin"}), search.SubAnagrams("Li-sTen"));
+}
+
+TEST (AnagramSearch, phrases_use_all_letters)
+{
+    AnagramSearch search({"dormitory", "dirty", "room", "dirt", "moor", "y"});
+    std::vector<Phrase> expected = {{"dormitory"}, {"dirty", "moor"}, {"dirty", "room"},
+                                    {"dirt", "moor", "y"}, {"dirt", "room", "y"}};
+    EXPECT_EQ(expected, search.Phrases("dirty room", 3, 100));
+}
+
+TEST (AnagramSearch, phrases_limited_by_words)
+{
+    AnagramSearch search({"dormitory", "dirty", "room", "dirt", "y"});
+    std::vector<Phrase> expected = {{"dormitory"}, {"dirty", "room"}};
+    EXPECT_EQ(expected, search.Phrases("dormitory", 2, 100));
+}
+
+TEST (AnagramSearch, phrases_limited_by_results)
+{
+    AnagramSearch search({"ab", "ba", "a", "b"});
+    EXPECT_EQ(3u, search.Phrases("ab", 2, 3).size());
+}
+
+TEST (AnagramSearch, repeated_word_reported_once)
+{
+    AnagramSearch search({"ab", "ba"});
+    std::vector<Phrase> expected = {{"ab", "ab"}, {"ab", "ba"}, {"ba", "ba"}};
+    EXPECT_EQ(expected, search.Phrases("aabb", 2, 100));
+}
+
+std::vector<std::string> GenerateDictionary(size_t size)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> length(3, 8);
+    // Small alphabet gives plenty of anagrams
+    std::uniform_int_distribution<int> letter('a', 'l');
+    std::vector<std::string> dictionary(size);
+    for (std::string& word : dictionary)
+    {
+        word.resize(length(random));
+        std::generate(word.begin(), word.end(), [&]() { return static_cast<char>(letter(random)); });
+    }
+    return dictionary;
+}
+
+TEST (AnagramIndex, matches_GetAnagrams)
+{
+    const std::vector<std::string> dictionary = GenerateDictionary(20000);
+    AnagramIndex index(dictionary);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        const Anagrams expected = GetAnagrams(dictionary[i], dictionary);
+        EXPECT_EQ(std::vector<std::string>(expected.begin(), expected.end()), index.Find(dictionary[i]));
+    }
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST (AnagramIndex, DISABLED_benchmark)
+{
+    const std::vector<std::string> dictionary = GenerateDictionary(2000000);
+    const size_t linearQueries = 10;
+    const size_t indexQueries = 1000000;
+
+    auto begin = std::chrono::steady_clock::now();
+    AnagramIndex index(dictionary);
+    std::cout << "build: " << MillisecondsSince(begin) << " ms for " << index.Size() << " words" << std::endl;
+
+    size_t found = 0;
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < linearQueries; ++i)
+    {
+        found += GetAnagrams(dictionary[i], dictionary).size();
+    }
+    std::cout << "GetAnagrams: " << MillisecondsSince(begin) * 1000 / linearQueries << " us per query" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < indexQueries; ++i)
+    {
+        found += index.Find(dictionary[i % dictionary.size()]).size();
+    }
+    std::cout << "AnagramIndex: " << MillisecondsSince(begin) * 1000 / indexQueries << " us per query, "
+              << found << " anagrams found" << std::endl;
+}
+
+bool IsAnagramsBySorting(std::string left, std::string right)
+{
+    if (left == right || left.empty() || right.empty())
+    {
+        return false;
+    }
+    std::sort (left.begin(), left.end());
+    std::sort (right.begin(), right.end());
+    return left == right;
+}
+
+TEST (IsAnagrams, matches_sorting_implementation)
+{
+    const std::vector<std::string> dictionary = GenerateDictionary(2000);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        for (const std::string& candidate : dictionary)
+        {
+            ASSERT_EQ(IsAnagramsBySorting(dictionary[i], candidate), IsAnagrams(dictionary[i], candidate))
+                << dictionary[i] << " " << candidate;
+        }
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST (IsAnagrams, DISABLED_benchmark)
+{
+    const std::vector<std::string> dictionary = GenerateDictionary(1000000);
+    const std::vector<std::string> queries(dictionary.begin(), dictionary.begin() + 10);
+
+    size_t found = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (const std::string& query : queries)
+    {
+        found += std::count_if(dictionary.begin(), dictionary.end(),
+                               [&](const std::string& candidate) { return IsAnagramsBySorting(query, candidate); });
+    }
+    std::cout << "sorting: " << MillisecondsSince(begin) * 1000000 / (queries.size() * dictionary.size())
+              << " ns per pair" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+    for (const std::string& query : queries)
+    {
+        found += std::count_if(dictionary.begin(), dictionary.end(),
+                               [&](const std::string& candidate) { return IsAnagrams(query, candidate); });
+    }
+    std::cout << "histogram: " << MillisecondsSince(begin) * 1000000 / (queries.size() * dictionary.size())
+              << " ns per pair, " << found << " anagrams found" << std::endl;
+
+    // Pairs of equal size only, where the histograms are actually compared
+    std::vector<std::string> sameSize;
+    std::copy_if(dictionary.begin(), dictionary.end(), std::back_inserter(sameSize),
+                 [&](const std::string& candidate) { return candidate.size() == queries.front().size(); });
+    begin = std::chrono::steady_clock::now();
+    for (const std::string& candidate : sameSize)
+    {
+        found += HaveSameLetters<uint8_t>(queries.front(), candidate);
+    }
+    std::cout << "same size, 256 counters: " << MillisecondsSince(begin) * 1000000 / sameSize.size() << " ns per pair" << std::endl;
+    begin = std::chrono::steady_clock::now();
+    for (const std::string& candidate : sameSize)
+    {
+        found += IsAnagrams(queries.front(), candidate);
+    }
+    std::cout << "same size, IsAnagrams: " << MillisecondsSince(begin) * 1000000 / sameSize.size() << " ns per pair, "
+              << found << " anagrams found" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+    for (const std::string& query : queries)
+    {
+        found += GetAnagrams(query, dictionary).size();
+    }
+    std::cout << "GetAnagrams: " << MillisecondsSince(begin) / queries.size() << " ms per query" << std::endl;
+
+    begin = std::chrono::steady_clock::now();
+    for (const std::string& query : queries)
+    {
+        found += GetAnagramList(query, dictionary).size();
+    }
+    std::cout << "GetAnagramList: " << MillisecondsSince(begin) / queries.size() << " ms per query" << std::endl;
+}
+
+TEST (GetAnagramListParallel, matches_sequential_version)
+{
+    const std::vector<std::string> dictionary = GenerateDictionary(20000);
+    for (size_t threads = 1; threads <= 8; ++threads)
+    {
+        for (size_t i = 0; i < 10; ++i)
+        {
+            ASSERT_EQ(GetAnagramList(dictionary[i], dictionary), GetAnagramListParallel(dictionary[i], dictionary, threads))
+                << threads << " threads";
+        }
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST (GetAnagramListParallel, DISABLED_benchmark)
+{
+    const std::vector<std::string> dictionary = GenerateDictionary(5000000);
+    const size_t queries = 10;
+
+    double singleThreadMs = 0;
+    for (size_t threads = 1; threads <= std::max<size_t>(DefaultThreadCount(), 4); threads *= 2)
+    {
+        size_t found = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < queries; ++i)
+        {
+            found += GetAnagramListParallel(dictionary[i], dictionary, threads).size();
+        }
+        const double ms = MillisecondsSince(begin) / queries;
+        if (threads == 1)
+        {
+            singleThreadMs = ms;
+        }
+        std::cout << threads << " thread(s): " << ms << " ms per query, speedup " << singleThreadMs / ms
+                  << ", " << found << " anagrams found" << std::endl;
+    }
+}
+
+// Dictionary of words with roughly English letter frequencies
+std::vector<std::string> GenerateWordGameDictionary(size_t size, unsigned seed)
+{
+    static const std::string s_letters = "eeeeeeeeeeeetttttttttaaaaaaaaoooooooiiiiiiinnnnnnnsssssshhhhhhrrrrrrddddllllcccuuummwwffggyyppbbvkjxqz";
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<size_t> length(2, 12);
+    std::uniform_int_distribution<size_t> letter(0, s_letters.size() - 1);
+    std::vector<std::string> dictionary(size);
+    for (std::string& word : dictionary)
+    {
+        word.resize(length(random));
+        std::generate(word.begin(), word.end(), [&]() { return s_letters[letter(random)]; });
+    }
+    return dictionary;
+}
+
+TEST (AnagramSearch, sub_anagrams_match_brute_force)
+{
+    const std::vector<std::string> dictionary = GenerateWordGameDictionary(5000, 1);
+    AnagramSearch search(dictionary);
+    for (const std::string& query : GenerateWordGameDictionary(20, 2))
+    {
+        const LetterCounts available = AnagramSearch::CountLetters(query);
+        std::set<std::string> expected;
+        for (const std::string& word : dictionary)
+        {
+            const LetterCounts needed = AnagramSearch::CountLetters(word);
+            if (std::equal(needed.begin(), needed.end(), available.begin(), std::less_equal<uint8_t>()))
+            {
+                expected.insert(word);
+            }
+        }
+        EXPECT_EQ(std::vector<std::string>(expected.begin(), expected.end()), search.SubAnagrams(query)) << query;
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST (AnagramSearch, DISABLED_benchmark)
+{
+    const std::vector<std::string> dictionary = GenerateWordGameDictionary(500000, 42);
+    auto begin = std::chrono::steady_clock::now();
+    AnagramSearch search(dictionary);
+    std::cout << "build: " << MillisecondsSince(begin) << " ms" << std::endl;
+
+    std::mt19937 random(7);
+    for (size_t length = 8; length <= 15; ++length)
+    {
+        std::vector<std::string> queries(100);
+        for (std::string& query : queries)
+        {
+            query = dictionary[random() % dictionary.size()] + dictionary[random() % dictionary.size()];
+            query.resize(std::min(query.size(), length));
+        }
+
+        size_t words = 0;
+        begin = std::chrono::steady_clock::now();
+        for (const std::string& query : queries)
+        {
+            words += search.SubAnagrams(query).size();
+        }
+        const double subAnagramsMs = MillisecondsSince(begin) / queries.size();
+
+        size_t phrases = 0;
+        begin = std::chrono::steady_clock::now();
+        for (const std::string& query : queries)
+        {
+            phrases += search.Phrases(query, 3, 1000).size();
+        }
+        const double phrasesMs = MillisecondsSince(begin) / queries.size();
+
+        std::cout << "up to " << length << " letters: SubAnagrams " << subAnagramsMs << " ms (" << words / queries.size()
+                  << " words), Phrases " << phrasesMs << " ms (" << phrases / queries.size() << " phrases)" << std::endl;
+    }
+}
@@ -1,10 +1,12 @@
 include(../../gtest.pri)
 
 TEMPLATE = app
-CONFIG += console c++11
+CONFIG += console c++17 thread
 CONFIG -= app_bundle
 CONFIG -= qt
 
+DEFINES += NOMINMAX
+
 SOURCES += \
     test.cpp
 
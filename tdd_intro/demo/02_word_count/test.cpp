@@ -15,5 +15,1357 @@ such: 1
 
 #include <gtest/gtest.h>
 #include <string>
+#include <string_view>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Architecture:
+ * Words are never copied: the tokenizer yields std::string_view slices of the input buffer
+ * and WordCounter stores those views, so the counted text must outlive the counter.
+ * WordCounter is a flat open-addressing hash table (linear probing, power of two capacity)
+ * keyed by a 64-bit hash that consumes the word 8 bytes at a time.
+ * Result sorted by frequency is built only on demand.
+ *
+ * Parallel mode (map-reduce):
+ * the input (usually a memory mapped file) is split into chunks at word boundaries,
+ * every worker counts its chunk into its own WordCounter, then the counters are merged
+ * pairwise in parallel rounds, so the reduction takes log2(workers) steps.
+*/
+
+using WordCount = std::map<std::string, size_t>;
+
+struct WordFrequency
+{
+    std::string_view word;
+    size_t count;
+
+    bool operator==(const WordFrequency& other) const
+    {
+        return word == other.word && count == other.count;
+    }
+};
+using WordFrequencies = std::vector<WordFrequency>;
+
+// Words consist of ASCII letters and digits
+inline bool IsWordChar(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+// Calls func for every word of the text, whitespaces and punctual symbols are skipped.
+// Byte by byte reference implementation.
+template<typename Func>
+void ForEachWord(std::string_view text, Func func)
+{
+    const size_t size = text.size();
+    size_t pos = 0;
+    while (pos < size)
+    {
+        while (pos < size && !IsWordChar(text[pos]))
+        {
+            ++pos;
+        }
+        const size_t begin = pos;
+        while (pos < size && IsWordChar(text[pos]))
+        {
+            ++pos;
+        }
+        if (pos != begin)
+        {
+            func(text.substr(begin, pos - begin));
+        }
+    }
+}
+
+/*
+ * Vectorized tokenizer:
+ * every block of 16 (SSSE3) or 32 (AVX2) bytes is classified with two pshufb lookups,
+ * by low and high nibble of each byte, whose AND is non-zero only for [0-9A-Za-z].
+ * movemask turns the classes into a bitmask and word boundaries are the bits where
+ * the mask changes its value. Implementation is selected at runtime, the tail shorter
+ * than a block and the CPUs without SSSE3 are handled by the scalar code.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WORD_COUNT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define WORD_COUNT_TARGET(isa) __attribute__((target(isa)))
+#else
+#define WORD_COUNT_TARGET(isa)
+#endif
+
+enum class Isa
+{
+    Scalar,
+    Ssse3,
+    Avx2
+};
+
+Isa DetectIsa()
+{
+#if defined(WORD_COUNT_X86) && defined(__GNUC__)
+    static const Isa s_isa = __builtin_cpu_supports("avx2") ? Isa::Avx2
+                           : __builtin_cpu_supports("ssse3") ? Isa::Ssse3 : Isa::Scalar;
+#elif defined(WORD_COUNT_X86) && defined(_MSC_VER)
+    static const Isa s_isa = []()
+    {
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool ssse3 = (info[2] & (1 << 9)) != 0;
+        const bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osSavesAvx)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+        return avx2 ? Isa::Avx2 : ssse3 ? Isa::Ssse3 : Isa::Scalar;
+    }();
+#else
+    static const Isa s_isa = Isa::Scalar;
+#endif
+    return s_isa;
+}
+
+inline unsigned CountTrailingZeros(uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return index;
+#else
+    return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+}
+
+inline char ToLowerAscii(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+// Emits words found in the sequence of per-block bitmasks of word characters
+class WordBoundaryTracker
+{
+public:
+    explicit WordBoundaryTracker(const char* words)
+        : m_words(words), m_wordBegin(0), m_inWord(false)
+    { }
+
+    // mask has a bit per byte of the block of given size starting at offset
+    template<typename Func>
+    void Feed(uint32_t mask, size_t blockSize, size_t offset, Func& func)
+    {
+        const uint32_t blockBits = blockSize == 32 ? ~0u : (1u << blockSize) - 1;
+        uint32_t transitions = (mask ^ ((mask << 1) | (m_inWord ? 1u : 0u))) & blockBits;
+        while (transitions != 0)
+        {
+            const size_t pos = offset + CountTrailingZeros(transitions);
+            transitions &= transitions - 1;
+            if (m_inWord)
+            {
+                func(std::string_view(m_words + m_wordBegin, pos - m_wordBegin));
+            }
+            else
+            {
+                m_wordBegin = pos;
+            }
+            m_inWord = !m_inWord;
+        }
+    }
+
+    template<typename Func>
+    void Finish(size_t size, Func& func)
+    {
+        if (m_inWord)
+        {
+            func(std::string_view(m_words + m_wordBegin, size - m_wordBegin));
+            m_inWord = false;
+        }
+    }
+
+private:
+    const char* m_words;
+    size_t m_wordBegin;
+    bool m_inWord;
+};
+
+// Scalar classification of up to 32 bytes, optionally stores lowercased bytes
+inline uint32_t ClassifyScalar(const char* data, size_t size, char* lowercase)
+{
+    uint32_t mask = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        mask |= static_cast<uint32_t>(IsWordChar(data[i])) << i;
+        if (lowercase)
+        {
+            lowercase[i] = ToLowerAscii(data[i]);
+        }
+    }
+    return mask;
+}
+
+template<typename Func>
+void TokenizeScalar(std::string_view text, char* lowercase, Func& func)
+{
+    WordBoundaryTracker tracker(lowercase ? lowercase : text.data());
+    for (size_t pos = 0; pos < text.size(); pos += 32)
+    {
+        const size_t blockSize = std::min<size_t>(32, text.size() - pos);
+        tracker.Feed(ClassifyScalar(text.data() + pos, blockSize, lowercase ? lowercase + pos : nullptr),
+                     blockSize, pos, func);
+    }
+    tracker.Finish(text.size(), func);
+}
+
+#ifdef WORD_COUNT_X86
+// Class bits by low nibble: 1 - '0'..'9', 2 - 'A'..'O' / 'a'..'o', 4 - 'P'..'Z' / 'p'..'z'
+#define WORD_COUNT_LOW_NIBBLE_CLASSES 5, 7, 7, 7, 7, 7, 7, 7, 7, 7, 6, 2, 2, 2, 2, 2
+// Class bits by high nibble: 3 - digits, 4 and 6 - first half of letters, 5 and 7 - second half
+#define WORD_COUNT_HIGH_NIBBLE_CLASSES 0, 0, 0, 1, 2, 4, 2, 4, 0, 0, 0, 0, 0, 0, 0, 0
+
+template<typename Func>
+WORD_COUNT_TARGET("ssse3")
+void TokenizeSsse3(std::string_view text, char* lowercase, Func& func)
+{
+    const __m128i lowClasses = _mm_setr_epi8(WORD_COUNT_LOW_NIBBLE_CLASSES);
+    const __m128i highClasses = _mm_setr_epi8(WORD_COUNT_HIGH_NIBBLE_CLASSES);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i beforeUpper = _mm_set1_epi8('A' - 1);
+    const __m128i afterUpper = _mm_set1_epi8('Z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+
+    WordBoundaryTracker tracker(lowercase ? lowercase : text.data());
+    size_t pos = 0;
+    for (; pos + 16 <= text.size(); pos += 16)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        const __m128i low = _mm_and_si128(bytes, nibble);
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+        const __m128i classes = _mm_and_si128(_mm_shuffle_epi8(lowClasses, low), _mm_shuffle_epi8(highClasses, high));
+        const __m128i isWord = _mm_cmpgt_epi8(classes, _mm_setzero_si128());
+        if (lowercase)
+        {
+            const __m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(bytes, beforeUpper), _mm_cmpgt_epi8(afterUpper, bytes));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lowercase + pos),
+                             _mm_or_si128(bytes, _mm_and_si128(isUpper, caseBit)));
+        }
+        tracker.Feed(static_cast<uint32_t>(_mm_movemask_epi8(isWord)), 16, pos, func);
+    }
+
+    const size_t tailSize = text.size() - pos;
+    tracker.Feed(ClassifyScalar(text.data() + pos, tailSize, lowercase ? lowercase + pos : nullptr), tailSize, pos, func);
+    tracker.Finish(text.size(), func);
+}
+
+template<typename Func>
+WORD_COUNT_TARGET("avx2")
+void TokenizeAvx2(std::string_view text, char* lowercase, Func& func)
+{
+    // pshufb looks up within each 128-bit lane, so both lanes hold the same table
+    const __m256i lowClasses = _mm256_setr_epi8(WORD_COUNT_LOW_NIBBLE_CLASSES, WORD_COUNT_LOW_NIBBLE_CLASSES);
+    const __m256i highClasses = _mm256_setr_epi8(WORD_COUNT_HIGH_NIBBLE_CLASSES, WORD_COUNT_HIGH_NIBBLE_CLASSES);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i beforeUpper = _mm256_set1_epi8('A' - 1);
+    const __m256i afterUpper = _mm256_set1_epi8('Z' + 1);
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+
+    WordBoundaryTracker tracker(lowercase ? lowercase : text.data());
+    size_t pos = 0;
+    for (; pos + 32 <= text.size(); pos += 32)
+    {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + pos));
+        const __m256i low = _mm256_and_si256(bytes, nibble);
+        const __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+        const __m256i classes = _mm256_and_si256(_mm256_shuffle_epi8(lowClasses, low),
+                                                 _mm256_shuffle_epi8(highClasses, high));
+        const __m256i isWord = _mm256_cmpgt_epi8(classes, _mm256_setzero_si256());
+        if (lowercase)
+        {
+            const __m256i isUpper = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, beforeUpper),
+                                                     _mm256_cmpgt_epi8(afterUpper, bytes));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lowercase + pos),
+                                _mm256_or_si256(bytes, _mm256_and_si256(isUpper, caseBit)));
+        }
+        tracker.Feed(static_cast<uint32_t>(_mm256_movemask_epi8(isWord)), 32, pos, func);
+    }
+
+    const size_t tailSize = text.size() - pos;
+    tracker.Feed(ClassifyScalar(text.data() + pos, tailSize, lowercase ? lowercase + pos : nullptr), tailSize, pos, func);
+    tracker.Finish(text.size(), func);
+}
+#endif
+
+// Same words as ForEachWord, but found with the widest vector instructions available.
+// When lowercase buffer of text size is given, lowercased text is stored there
+// and the words passed to func are views of that buffer.
+template<typename Func>
+void ForEachWordSimd(std::string_view text, Func func, char* lowercase = nullptr, Isa isa = DetectIsa())
+{
+    switch (isa)
+    {
+#ifdef WORD_COUNT_X86
+    case Isa::Avx2:
+        TokenizeAvx2(text, lowercase, func);
+        return;
+    case Isa::Ssse3:
+        TokenizeSsse3(text, lowercase, func);
+        return;
+#endif
+    default:
+        TokenizeScalar(text, lowercase, func);
+    }
+}
+
+inline uint64_t HashWord(std::string_view word)
+{
+    static const uint64_t s_multiplier = 0x9E3779B97F4A7C15ull;
+    const char* data = word.data();
+    const size_t size = word.size();
+
+    uint64_t hash = size * s_multiplier;
+    size_t pos = 0;
+    for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t))
+    {
+        uint64_t chunk;
+        std::memcpy(&chunk, data + pos, sizeof(chunk));
+        hash = (hash ^ chunk) * s_multiplier;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + pos, size - pos);
+    hash = (hash ^ tail) * s_multiplier;
+    return hash ^ (hash >> 29);
+}
+
+class WordCounter
+{
+public:
+    explicit WordCounter(size_t expectedWords = 1024)
+        : m_size(0)
+    {
+        size_t capacity = 16;
+        while (capacity < expectedWords * 2)
+        {
+            capacity *= 2;
+        }
+        m_slots.resize(capacity);
+    }
+
+    // Counts every word of the text. The text must outlive the counter.
+    void Add(std::string_view text)
+    {
+        ForEachWordSimd(text, [this](std::string_view word) { AddWord(word); });
+    }
+
+    // Zero count adds nothing, empty slots are marked by zero count
+    void AddWord(std::string_view word, size_t count = 1)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        AddHashedWord(word, HashWord(word), count);
+    }
+
+    // Adds counts of the other counter to this one
+    void Merge(const WordCounter& other)
+    {
+        for (const Slot& slot : other.m_slots)
+        {
+            if (slot.count != 0)
+            {
+                AddHashedWord(slot.word, slot.hash, slot.count);
+            }
+        }
+    }
+
+    size_t Count(std::string_view word) const
+    {
+        return m_slots[FindSlot(word, HashWord(word))].count;
+    }
+
+    // Number of distinct words
+    size_t Size() const
+    {
+        return m_size;
+    }
+
+    // Calls func(word, count) for every distinct word in unspecified order
+    template<typename Func>
+    void ForEach(Func func) const
+    {
+        for (const Slot& slot : m_slots)
+        {
+            if (slot.count != 0)
+            {
+                func(slot.word, slot.count);
+            }
+        }
+    }
+
+    // Most frequent words first, words with equal count are ordered alphabetically
+    WordFrequencies SortedByFrequency() const
+    {
+        WordFrequencies result;
+        result.reserve(m_size);
+        ForEach([&result](std::string_view word, size_t count) { result.push_back({word, count}); });
+        std::sort(result.begin(), result.end(), [](const WordFrequency& left, const WordFrequency& right)
+        {
+            return left.count != right.count ? left.count > right.count : left.word < right.word;
+        });
+        return result;
+    }
+
+private:
+    // Empty slot has zero count
+    struct Slot
+    {
+        std::string_view word;
+        uint64_t hash = 0;
+        size_t count = 0;
+    };
+
+    void AddHashedWord(std::string_view word, uint64_t hash, size_t count)
+    {
+        if ((m_size + 1) * 4 > m_slots.size() * 3)
+        {
+            Grow();
+        }
+        Slot& slot = m_slots[FindSlot(word, hash)];
+        if (slot.count == 0)
+        {
+            slot.word = word;
+            slot.hash = hash;
+            ++m_size;
+        }
+        slot.count += count;
+    }
+
+    // Returns index of the slot with given word or of the empty slot where it should be placed
+    size_t FindSlot(std::string_view word, uint64_t hash) const
+    {
+        const size_t mask = m_slots.size() - 1;
+        for (size_t index = hash & mask;; index = (index + 1) & mask)
+        {
+            const Slot& slot = m_slots[index];
+            if (slot.count == 0 || (slot.hash == hash && slot.word == word))
+            {
+                return index;
+            }
+        }
+    }
+
+    void Grow()
+    {
+        std::vector<Slot> slots(m_slots.size() * 2);
+        m_slots.swap(slots);
+        const size_t mask = m_slots.size() - 1;
+        for (const Slot& slot : slots)
+        {
+            if (slot.count == 0)
+            {
+                continue;
+            }
+            size_t index = slot.hash & mask;
+            while (m_slots[index].count != 0)
+            {
+                index = (index + 1) & mask;
+            }
+            m_slots[index] = slot;
+        }
+    }
+
+private:
+    std::vector<Slot> m_slots;
+    size_t m_size;
+};
+
+// Straightforward implementation, used as the reference in tests and the baseline in benchmark
+WordCount CountWordsReference(std::string_view text)
+{
+    WordCount result;
+    ForEachWord(text, [&result](std::string_view word) { ++result[std::string(word)]; });
+    return result;
+}
+
+WordCount ToWordCount(const WordCounter& counter)
+{
+    WordCount result;
+    counter.ForEach([&result](std::string_view word, size_t count) { result[std::string(word)] = count; });
+    return result;
+}
+
+// Read-only memory mapping of the whole file. Throws std::runtime_error on failure.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+        : m_data(nullptr), m_size(0)
+    {
+#ifdef _WIN32
+        HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Failed to open file " + path);
+        }
+        LARGE_INTEGER size;
+        if (!::GetFileSizeEx(file, &size))
+        {
+            ::CloseHandle(file);
+            throw std::runtime_error("Failed to stat file " + path);
+        }
+        m_size = static_cast<size_t>(size.QuadPart);
+        if (m_size != 0)
+        {
+            HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            m_data = mapping ? static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (mapping)
+            {
+                ::CloseHandle(mapping); // The view keeps the mapping alive
+            }
+        }
+        ::CloseHandle(file);
+        if (m_size != 0 && m_data == nullptr)
+        {
+            throw std::runtime_error("Failed to map file " + path);
+        }
+#else
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file == -1)
+        {
+            throw std::runtime_error("Failed to open file " + path);
+        }
+        struct stat info;
+        if (::fstat(file, &info) != 0)
+        {
+            ::close(file);
+            throw std::runtime_error("Failed to stat file " + path);
+        }
+        m_size = static_cast<size_t>(info.st_size);
+        void* data = m_size != 0 ? ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0) : nullptr;
+        ::close(file); // The mapping stays valid after the descriptor is closed
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("Failed to map file " + path);
+        }
+        if (data != nullptr)
+        {
+            ::madvise(data, m_size, MADV_SEQUENTIAL);
+        }
+        m_data = static_cast<const char*>(data);
+#endif
+    }
+
+    ~MappedFile()
+    {
+        if (m_data == nullptr)
+        {
+            return;
+        }
+#ifdef _WIN32
+        ::UnmapViewOfFile(m_data);
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view Data() const
+    {
+        return std::string_view(m_data, m_size);
+    }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+size_t DefaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Splits the text into at most given number of chunks of similar size.
+// Chunk end is moved forward to the nearest non-word character, so no word is split between chunks.
+std::vector<std::string_view> SplitAtWordBoundaries(std::string_view text, size_t chunks)
+{
+    std::vector<std::string_view> result;
+    const size_t chunkSize = text.size() / std::max<size_t>(chunks, 1) + 1;
+    for (size_t begin = 0; begin < text.size();)
+    {
+        size_t end = std::min(begin + chunkSize, text.size());
+        while (end < text.size() && IsWordChar(text[end]))
+        {
+            ++end;
+        }
+        result.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+    return result;
+}
+
+// Calls func(index) for every index in [0, tasks), each on its own thread
+template<typename Func>
+void RunInParallel(size_t tasks, Func func)
+{
+    std::vector<std::thread> threads;
+    for (size_t index = 1; index < tasks; ++index)
+    {
+        threads.emplace_back(func, index);
+    }
+    if (tasks != 0)
+    {
+        func(0);
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// Counts words of the text on given number of threads. The text must outlive the result.
+WordCounter CountWordsParallel(std::string_view text, size_t threadCount = DefaultThreadCount())
+{
+    const std::vector<std::string_view> chunks = SplitAtWordBoundaries(text, threadCount);
+    if (chunks.empty())
+    {
+        return WordCounter();
+    }
+
+    std::vector<WordCounter> counters(chunks.size());
+    RunInParallel(chunks.size(), [&](size_t index) { counters[index].Add(chunks[index]); });
+
+    // On every round counter i absorbs counter i + step, for all i multiple of 2 * step
+    for (size_t step = 1; step < counters.size(); step *= 2)
+    {
+        const size_t merges = (counters.size() + step - 1) / (2 * step);
+        RunInParallel(merges, [&](size_t merge)
+        {
+            const size_t index = merge * 2 * step;
+            counters[index].Merge(counters[index + step]);
+            counters[index + step] = WordCounter(0);
+        });
+    }
+    return std::move(counters.front());
+}
+
+/*
+ * Top-K mode for unbounded streams (Space-Saving algorithm):
+ * at most `capacity` words are monitored. Unknown word replaces the monitored word with
+ * the smallest count and inherits that count as its error. Reported count never underestimates
+ * the true one and overestimates it by at most `error`, which itself is not greater than
+ * TotalWords() / capacity, so every word more frequent than that is guaranteed to be reported.
+ * Memory is fixed by the capacity (plus the word which is split between the last two chunks).
+*/
+
+struct WordHasher
+{
+    size_t operator()(std::string_view word) const
+    {
+        return static_cast<size_t>(HashWord(word));
+    }
+};
+
+struct HeavyHitter
+{
+    std::string word;
+    size_t count;
+    size_t error;
+
+    // Guaranteed number of occurrences
+    size_t LowerBound() const
+    {
+        return count - error;
+    }
+};
+using HeavyHitterList = std::vector<HeavyHitter>;
+
+class HeavyHitters
+{
+public:
+    explicit HeavyHitters(size_t capacity)
+        : m_capacity(std::max<size_t>(capacity, 1)), m_totalWords(0), m_evicted(false)
+    {
+        m_counters.reserve(m_capacity);
+        m_heap.reserve(m_capacity);
+        m_index.reserve(m_capacity);
+    }
+
+    // Keys of the index refer to the words of this object
+    HeavyHitters(const HeavyHitters&) = delete;
+    HeavyHitters& operator=(const HeavyHitters&) = delete;
+    HeavyHitters(HeavyHitters&&) = delete;
+    HeavyHitters& operator=(HeavyHitters&&) = delete;
+
+    // Counts words of the next chunk of the stream. Word split between chunks is counted once.
+    void AddChunk(std::string_view chunk)
+    {
+        if (!m_pending.empty())
+        {
+            const size_t prefix = WordPrefixLength(chunk);
+            m_pending.append(chunk.data(), prefix);
+            if (prefix == chunk.size())
+            {
+                return;
+            }
+            AddWord(m_pending);
+            m_pending.clear();
+            chunk.remove_prefix(prefix);
+        }
+
+        size_t suffixBegin = chunk.size();
+        while (suffixBegin != 0 && IsWordChar(chunk[suffixBegin - 1]))
+        {
+            --suffixBegin;
+        }
+        ForEachWordSimd(chunk.substr(0, suffixBegin), [this](std::string_view word) { AddWord(word); });
+        m_pending.assign(chunk.data() + suffixBegin, chunk.size() - suffixBegin);
+    }
+
+    // Counts the word left at the end of the last chunk
+    void Finish()
+    {
+        if (!m_pending.empty())
+        {
+            AddWord(m_pending);
+            m_pending.clear();
+        }
+    }
+
+    void AddWord(std::string_view word)
+    {
+        ++m_totalWords;
+        auto found = m_index.find(word);
+        if (found != m_index.end())
+        {
+            ++m_counters[found->second].count;
+            SiftDown(m_positions[found->second]);
+            return;
+        }
+
+        if (m_counters.size() < m_capacity)
+        {
+            m_counters.push_back({std::string(word), 1, 0});
+            m_positions.push_back(m_heap.size());
+            m_heap.push_back(m_counters.size() - 1);
+            m_index.emplace(m_counters.back().word, m_counters.size() - 1);
+            SiftUp(m_heap.size() - 1);
+            return;
+        }
+
+        // Replace the least frequent word, its key must be removed before the string is reused
+        const size_t evicted = m_heap.front();
+        HeavyHitter& counter = m_counters[evicted];
+        m_evicted = true;
+        m_index.erase(counter.word);
+        counter.word.assign(word.data(), word.size());
+        counter.error = counter.count;
+        ++counter.count;
+        m_index.emplace(counter.word, evicted);
+        SiftDown(0);
+    }
+
+    // Up to k most frequent words, most frequent first
+    HeavyHitterList Top(size_t k) const
+    {
+        HeavyHitterList result(m_counters);
+        std::sort(result.begin(), result.end(), [](const HeavyHitter& left, const HeavyHitter& right)
+        {
+            return left.count != right.count ? left.count > right.count : left.word < right.word;
+        });
+        result.resize(std::min(k, result.size()));
+        return result;
+    }
+
+    size_t TotalWords() const
+    {
+        return m_totalWords;
+    }
+
+    // Upper bound of the error of any reported count
+    size_t MaxError() const
+    {
+        return m_evicted ? m_counters[m_heap.front()].count : 0;
+    }
+
+private:
+    static size_t WordPrefixLength(std::string_view text)
+    {
+        size_t length = 0;
+        while (length < text.size() && IsWordChar(text[length]))
+        {
+            ++length;
+        }
+        return length;
+    }
+
+    bool Less(size_t left, size_t right) const
+    {
+        return m_counters[m_heap[left]].count < m_counters[m_heap[right]].count;
+    }
+
+    void Swap(size_t left, size_t right)
+    {
+        std::swap(m_heap[left], m_heap[right]);
+        m_positions[m_heap[left]] = left;
+        m_positions[m_heap[right]] = right;
+    }
+
+    void SiftUp(size_t position)
+    {
+        while (position != 0 && Less(position, (position - 1) / 2))
+        {
+            Swap(position, (position - 1) / 2);
+            position = (position - 1) / 2;
+        }
+    }
+
+    void SiftDown(size_t position)
+    {
+        for (;;)
+        {
+            size_t smallest = position;
+            const size_t left = position * 2 + 1;
+            const size_t right = left + 1;
+            if (left < m_heap.size() && Less(left, smallest))
+            {
+                smallest = left;
+            }
+            if (right < m_heap.size() && Less(right, smallest))
+            {
+                smallest = right;
+            }
+            if (smallest == position)
+            {
+                return;
+            }
+            Swap(position, smallest);
+            position = smallest;
+        }
+    }
+
+private:
+    size_t m_capacity;
+    size_t m_totalWords;
+    bool m_evicted;
+    // Counters never move, so the index can refer to their words
+    std::vector<HeavyHitter> m_counters;
+    // Min-heap of counter indexes by count and position of every counter in it
+    std::vector<size_t> m_heap;
+    std::vector<size_t> m_positions;
+    std::unordered_map<std::string_view, size_t, WordHasher> m_index;
+    std::string m_pending;
+};
+
+TEST(ForEachWord, SkipsWhitespacesAndPunctuation)
+{
+    std::vector<std::string_view> words;
+    ForEachWord("  one, two!\tthree...", [&words](std::string_view word) { words.push_back(word); });
+    ASSERT_EQ(std::vector<std::string_view>({"one", "two", "three"}), words);
+}
+
+TEST(ForEachWord, OnlyPunctuation)
+{
+    size_t words = 0;
+    ForEachWord(" ,.!? ", [&words](std::string_view) { ++words; });
+    ASSERT_EQ(0u, words);
+}
+
+std::vector<Isa> SupportedIsas()
+{
+    std::vector<Isa> result = {Isa::Scalar};
+    if (DetectIsa() != Isa::Scalar)
+    {
+        result.push_back(Isa::Ssse3);
+    }
+    if (DetectIsa() == Isa::Avx2)
+    {
+        result.push_back(Isa::Avx2);
+    }
+    return result;
+}
+
+std::vector<std::string> WordsReference(std::string_view text, bool lowercase)
+{
+    std::vector<std::string> words;
+    ForEachWord(text, [&](std::string_view word)
+    {
+        words.emplace_back(word);
+        if (lowercase)
+        {
+            std::transform(words.back().begin(), words.back().end(), words.back().begin(), ToLowerAscii);
+        }
+    });
+    return words;
+}
+
+std::vector<std::string> WordsSimd(std::string_view text, bool lowercase, Isa isa)
+{
+    std::vector<std::string> words;
+    std::string buffer(text.size(), '\0');
+    ForEachWordSimd(text, [&words](std::string_view word) { words.emplace_back(word); },
+                    lowercase ? &buffer[0] : nullptr, isa);
+    return words;
+}
+
+TEST(ForEachWordSimd, Acceptance)
+{
+    const std::string text = "Olly, olly in COME free 42...";
+    for (Isa isa : SupportedIsas())
+    {
+        EXPECT_EQ(std::vector<std::string>({"Olly", "olly", "in", "COME", "free", "42"}), WordsSimd(text, false, isa));
+        EXPECT_EQ(std::vector<std::string>({"olly", "olly", "in", "come", "free", "42"}), WordsSimd(text, true, isa));
+    }
+}
+
+TEST(ForEachWordSimd, WordsCrossingBlocks)
+{
+    const std::string text = std::string(15, ' ') + std::string(40, 'a') + "," + std::string(31, 'B');
+    for (Isa isa : SupportedIsas())
+    {
+        EXPECT_EQ(WordsReference(text, false), WordsSimd(text, false, isa));
+        EXPECT_EQ(WordsReference(text, true), WordsSimd(text, true, isa));
+    }
+}
+
+TEST(ForEachWordSimd, MatchesScalarReferenceOnRandomBytes)
+{
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (size_t size = 0; size < 300; ++size)
+    {
+        std::string text(size, '\0');
+        std::generate(text.begin(), text.end(), [&]() { return static_cast<char>(byte(random)); });
+        for (Isa isa : SupportedIsas())
+        {
+            ASSERT_EQ(WordsReference(text, false), WordsSimd(text, false, isa)) << size << " bytes";
+            ASSERT_EQ(WordsReference(text, true), WordsSimd(text, true, isa)) << size << " bytes";
+        }
+    }
+}
+
+TEST(WordCounter, Empty)
+{
+    WordCounter counter;
+    counter.Add("");
+    EXPECT_EQ(0u, counter.Size());
+    EXPECT_EQ(0u, counter.Count("word"));
+}
+
+TEST(WordCounter, ZeroCount)
+{
+    WordCounter counter;
+    counter.AddWord("word", 0);
+    EXPECT_EQ(0u, counter.Size());
+    EXPECT_EQ(0u, counter.Count("word"));
+}
+
+TEST(WordCounter, SingleWord)
+{
+    WordCounter counter;
+    counter.Add("word");
+    EXPECT_EQ(1u, counter.Size());
+    EXPECT_EQ(1u, counter.Count("word"));
+}
+
+TEST(WordCounter, RepeatedWord)
+{
+    WordCounter counter;
+    counter.Add("word, word; word");
+    EXPECT_EQ(1u, counter.Size());
+    EXPECT_EQ(3u, counter.Count("word"));
+}
+
+TEST(WordCounter, GrowsBeyondInitialCapacity)
+{
+    std::string text;
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        text += "w" + std::to_string(i % 5000) + " ";
+    }
+    WordCounter counter(4);
+    counter.Add(text);
+    EXPECT_EQ(5000u, counter.Size());
+    EXPECT_EQ(2u, counter.Count("w4999"));
+    EXPECT_EQ(CountWordsReference(text), ToWordCount(counter));
+}
+
+TEST(WordCounter, SortedByFrequency)
+{
+    WordCounter counter;
+    counter.Add("b a c b c b");
+    WordFrequencies expected = {{"b", 3}, {"c", 2}, {"a", 1}};
+    ASSERT_EQ(expected, counter.SortedByFrequency());
+}
+
+TEST(WordCounter, Acceptance)
+{
+    WordCounter counter;
+    counter.Add("olly olly in come free please please let it be in such manner olly");
+    WordCount expected = {{"olly", 3}, {"in", 2}, {"come", 1}, {"free", 1}, {"please", 2}, {"let", 1},
+                          {"it", 1}, {"be", 1}, {"manner", 1}, {"such", 1}};
+    ASSERT_EQ(expected, ToWordCount(counter));
+}
+
+TEST(WordCounter, Merge)
+{
+    WordCounter left;
+    left.Add("a b b");
+    WordCounter right;
+    right.Add("b c");
+    left.Merge(right);
+    WordCount expected = {{"a", 1}, {"b", 3}, {"c", 1}};
+    ASSERT_EQ(expected, ToWordCount(left));
+}
+
+TEST(SplitAtWordBoundaries, EmptyText)
+{
+    ASSERT_TRUE(SplitAtWordBoundaries("", 4).empty());
+}
+
+TEST(SplitAtWordBoundaries, DoesNotSplitWords)
+{
+    std::vector<std::string_view> expected = {"abcd", " ef", " g"};
+    ASSERT_EQ(expected, SplitAtWordBoundaries("abcd ef g", 4));
+}
+
+TEST(SplitAtWordBoundaries, SingleChunk)
+{
+    std::vector<std::string_view> expected = {"ab cd"};
+    ASSERT_EQ(expected, SplitAtWordBoundaries("ab cd", 1));
+}
+
+TEST(CountWordsParallel, EmptyText)
+{
+    ASSERT_EQ(0u, CountWordsParallel("", 4).Size());
+}
+
+TEST(CountWordsParallel, MatchesReferenceForAnyThreadCount)
+{
+    std::string text;
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        text += "word" + std::to_string(i % 97) + ((i % 7 == 0) ? ", " : " ");
+    }
+    const WordCount expected = CountWordsReference(text);
+    for (size_t threads = 1; threads <= 9; ++threads)
+    {
+        EXPECT_EQ(expected, ToWordCount(CountWordsParallel(text, threads))) << threads << " threads";
+    }
+}
+
+TEST(MappedFile, MissingFileThrows)
+{
+    ASSERT_THROW(MappedFile(testing::TempDir() + "word_count_missing_file.txt"), std::runtime_error);
+}
+
+TEST(MappedFile, CountWordsInFile)
+{
+    const std::string path = testing::TempDir() + "word_count_test.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "olly olly in come free please please let it be in such manner olly";
+    }
+    {
+        MappedFile file(path);
+        WordCounter counter = CountWordsParallel(file.Data(), 3);
+        EXPECT_EQ(3u, counter.Count("olly"));
+        EXPECT_EQ(2u, counter.Count("please"));
+        EXPECT_EQ(10u, counter.Size());
+    }
+    std::remove(path.c_str());
+}
+
+std::string GenerateCorpus(size_t size)
+{
+    std::mt19937 random(42);
+    std::vector<std::string> vocabulary(50000);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<size_t> length(2, 12);
+    for (std::string& word : vocabulary)
+    {
+        word.resize(length(random));
+        std::generate(word.begin(), word.end(), [&]() { return static_cast<char>(letter(random)); });
+    }
+
+    // Squared uniform index gives a skewed, natural language like distribution
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::string corpus;
+    corpus.reserve(size + 16);
+    while (corpus.size() < size)
+    {
+        const double x = uniform(random);
+        corpus += vocabulary[static_cast<size_t>(x * x * (vocabulary.size() - 1))];
+        corpus += (corpus.size() % 13 == 0) ? ", " : " ";
+    }
+    return corpus;
+}
+
+WordCount ToWordCount(const HeavyHitterList& hitters)
+{
+    WordCount result;
+    for (const HeavyHitter& hitter : hitters)
+    {
+        result[hitter.word] = hitter.count;
+    }
+    return result;
+}
+
+TEST(HeavyHitters, ExactWhileCapacityIsNotExceeded)
+{
+    HeavyHitters hitters(10);
+    hitters.AddChunk("olly olly in come free please please let it be in such manner olly");
+    hitters.Finish();
+    WordCount expected = {{"olly", 3}, {"in", 2}, {"come", 1}, {"free", 1}, {"please", 2}, {"let", 1},
+                          {"it", 1}, {"be", 1}, {"manner", 1}, {"such", 1}};
+    EXPECT_EQ(expected, ToWordCount(hitters.Top(10)));
+    EXPECT_EQ(0u, hitters.MaxError());
+    EXPECT_EQ(14u, hitters.TotalWords());
+}
+
+TEST(HeavyHitters, TopIsSortedAndLimited)
+{
+    HeavyHitters hitters(10);
+    hitters.AddChunk("c a b b c c");
+    hitters.Finish();
+    HeavyHitterList top = hitters.Top(2);
+    ASSERT_EQ(2u, top.size());
+    EXPECT_EQ("c", top[0].word);
+    EXPECT_EQ(3u, top[0].count);
+    EXPECT_EQ("b", top[1].word);
+    EXPECT_EQ(2u, top[1].count);
+}
+
+TEST(HeavyHitters, EvictedWordErrorIsInherited)
+{
+    HeavyHitters hitters(2);
+    hitters.AddChunk("a a b c");
+    hitters.Finish();
+    HeavyHitterList top = hitters.Top(2);
+    ASSERT_EQ(2u, top.size());
+    EXPECT_EQ("a", top[0].word);
+    EXPECT_EQ(2u, top[0].count);
+    EXPECT_EQ(0u, top[0].error);
+    EXPECT_EQ("c", top[1].word);
+    EXPECT_EQ(2u, top[1].count);
+    EXPECT_EQ(1u, top[1].error);
+    EXPECT_EQ(2u, hitters.MaxError());
+}
+
+TEST(HeavyHitters, WordSplitBetweenChunks)
+{
+    HeavyHitters hitters(10);
+    hitters.AddChunk("wo");
+    hitters.AddChunk("r");
+    hitters.AddChunk("d wor");
+    hitters.AddChunk("d, ");
+    hitters.AddChunk("word");
+    hitters.Finish();
+    EXPECT_EQ(WordCount({{"word", 3}}), ToWordCount(hitters.Top(10)));
+}
+
+TEST(HeavyHitters, CountsAreWithinErrorBounds)
+{
+    const std::string text = GenerateCorpus(1 << 20);
+    const WordCount exact = CountWordsReference(text);
+
+    HeavyHitters hitters(1000);
+    for (size_t pos = 0; pos < text.size(); pos += 4099)
+    {
+        hitters.AddChunk(std::string_view(text).substr(pos, 4099));
+    }
+    hitters.Finish();
+
+    size_t total = 0;
+    for (const auto& word : exact)
+    {
+        total += word.second;
+    }
+    ASSERT_EQ(total, hitters.TotalWords());
+    ASSERT_LE(hitters.MaxError(), total / 1000);
+
+    const WordCount reported = ToWordCount(hitters.Top(1000));
+    for (const HeavyHitter& hitter : hitters.Top(1000))
+    {
+        const size_t trueCount = exact.at(hitter.word);
+        EXPECT_LE(hitter.LowerBound(), trueCount) << hitter.word;
+        EXPECT_GE(hitter.count, trueCount) << hitter.word;
+    }
+    for (const auto& word : exact)
+    {
+        if (word.second > hitters.MaxError())
+        {
+            EXPECT_EQ(1u, reported.count(word.first)) << word.first;
+        }
+    }
+}
+
+// Corpus size in megabytes can be changed with WORD_COUNT_CORPUS_MB environment variable
+size_t BenchmarkCorpusSize()
+{
+    const char* megabytes = std::getenv("WORD_COUNT_CORPUS_MB");
+    return (megabytes ? std::strtoul(megabytes, nullptr, 10) : 1024) << 20;
+}
+
+template<typename Func>
+void MeasureThroughput(const std::string& name, size_t bytes, Func func)
+{
+    auto begin = std::chrono::steady_clock::now();
+    const size_t distinctWords = func();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << name << ": " << seconds << " s, " << bytes / seconds / (1 << 20) << " MB/s, "
+              << distinctWords << " distinct words" << std::endl;
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(WordCounter, DISABLED_Benchmark)
+{
+    const std::string corpus = GenerateCorpus(BenchmarkCorpusSize());
+
+    MeasureThroughput("std::map", corpus.size(), [&]()
+    {
+        return CountWordsReference(corpus).size();
+    });
+    MeasureThroughput("std::unordered_map", corpus.size(), [&]()
+    {
+        std::unordered_map<std::string_view, size_t> counts;
+        ForEachWord(corpus, [&counts](std::string_view word) { ++counts[word]; });
+        return counts.size();
+    });
+    MeasureThroughput("WordCounter", corpus.size(), [&]()
+    {
+        WordCounter counter;
+        counter.Add(corpus);
+        return counter.Size();
+    });
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(CountWordsParallel, DISABLED_Benchmark)
+{
+    const std::string path = testing::TempDir() + "word_count_benchmark.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << GenerateCorpus(BenchmarkCorpusSize());
+    }
+    {
+        MappedFile file(path);
+        for (size_t threads = 1; threads <= std::max<size_t>(DefaultThreadCount(), 4); threads *= 2)
+        {
+            MeasureThroughput(std::to_string(threads) + " thread(s)", file.Data().size(), [&]()
+            {
+                return CountWordsParallel(file.Data(), threads).Size();
+            });
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(ForEachWordSimd, DISABLED_Benchmark)
+{
+    const std::string corpus = GenerateCorpus(BenchmarkCorpusSize());
+    std::string lowercase(corpus.size(), '\0');
+    const char* isaNames[] = {"scalar", "ssse3", "avx2"};
+
+    auto measure = [&](const std::string& name, auto tokenize)
+    {
+        size_t letters = 0;
+        auto begin = std::chrono::steady_clock::now();
+        tokenize([&letters](std::string_view word) { letters += word.size(); });
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": " << corpus.size() / seconds / (1 << 30) << " GB/s, " << letters << " letters" << std::endl;
+    };
+
+    measure("ForEachWord reference", [&](auto func) { ForEachWord(corpus, func); });
+    for (Isa isa : SupportedIsas())
+    {
+        const std::string name = isaNames[static_cast<int>(isa)];
+        measure(name, [&](auto func) { ForEachWordSimd(corpus, func, nullptr, isa); });
+        measure(name + " lowercase", [&](auto func) { ForEachWordSimd(corpus, func, &lowercase[0], isa); });
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(HeavyHitters, DISABLED_Benchmark)
+{
+    const std::string corpus = GenerateCorpus(BenchmarkCorpusSize());
+    const size_t chunkSize = 64 << 10;
+    const size_t k = 100;
+
+    WordCounter exact;
+    MeasureThroughput("exact WordCounter", corpus.size(), [&]()
+    {
+        exact.Add(corpus);
+        return exact.Size();
+    });
+    const WordFrequencies exactTop = exact.SortedByFrequency();
+
+    for (size_t capacity : {200, 1000, 10000})
+    {
+        HeavyHitters hitters(capacity);
+        MeasureThroughput("HeavyHitters(" + std::to_string(capacity) + ")", corpus.size(), [&]()
+        {
+            for (size_t pos = 0; pos < corpus.size(); pos += chunkSize)
+            {
+                hitters.AddChunk(std::string_view(corpus).substr(pos, chunkSize));
+            }
+            hitters.Finish();
+            return capacity;
+        });
+
+        // Accuracy of top-k: how many of the true top words are found and how far the counts are
+        const HeavyHitterList top = hitters.Top(k);
+        size_t found = 0;
+        double maxRelativeError = 0;
+        for (size_t i = 0; i < k && i < exactTop.size(); ++i)
+        {
+            const auto hitter = std::find_if(top.begin(), top.end(), [&](const HeavyHitter& candidate)
+            {
+                return candidate.word == exactTop[i].word;
+            });
+            if (hitter != top.end())
+            {
+                ++found;
+                const double error = static_cast<double>(hitter->count - exactTop[i].count) / exactTop[i].count;
+                maxRelativeError = std::max(maxRelativeError, error);
+            }
+        }
+        std::cout << "  top-" << k << " recall " << found << "/" << k << ", max relative error " << maxRelativeError
+                  << ", error bound " << hitters.MaxError() << " of " << hitters.TotalWords() << " words" << std::endl;
+    }
+}
@@ -0,0 +1,9 @@
+include(../../gtest.pri)
+
+TEMPLATE = app
+CONFIG += console c++17 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    test.cpp
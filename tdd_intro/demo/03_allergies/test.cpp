@@ -23,3 +23,766 @@ Your program should ignore those components of the score.
 For example, if the allergy score is 257, your program should only report the eggs (1) allergy.
 */
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 32-bit x86 has SSE2 only when the compiler is told so, ALLERGIES_NO_SSE2 forces the scalar code
+#if !defined(ALLERGIES_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ALLERGIES_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Architecture:
+ * Allergies keeps the low byte of the score as a bit mask, one bit per allergen.
+ * List() is a view over the set bits of the mask and is iterated without allocation.
+ * Batch scoring counts, for every allergen, how many scores in an array have its bit set:
+ * SSE2 kernel adds every bit of 16 scores into 16 byte counters per allergen and folds
+ * the counters with psadbw before they can overflow.
+*/
+
+enum class Allergen : uint8_t
+{
+    Eggs = 1,
+    Peanuts = 2,
+    Shellfish = 4,
+    Strawberries = 8,
+    Tomatoes = 16,
+    Chocolate = 32,
+    Pollen = 64,
+    Cats = 128
+};
+
+static constexpr size_t s_allergensCount = 8;
+static constexpr const char* s_allergenNames[s_allergensCount] =
+{
+    "eggs", "peanuts", "shellfish", "strawberries", "tomatoes", "chocolate", "pollen", "cats"
+};
+
+// Position of the allergen bit in the score
+inline size_t AllergenIndex(Allergen allergen)
+{
+    size_t index = 0;
+    for (uint8_t bit = static_cast<uint8_t>(allergen); bit > 1; bit >>= 1)
+    {
+        ++index;
+    }
+    return index;
+}
+
+inline const char* AllergenName(Allergen allergen)
+{
+    return s_allergenNames[AllergenIndex(allergen)];
+}
+
+/*
+ * Name to allergen lookup:
+ * names are placed into 16 slots by a hash of their length, first and last letter.
+ * The hash multiplier is searched at compile time, so that every name gets its own slot.
+ * Lookup computes the slot and compares the name stored there ignoring case,
+ * setting 0x20 bit of the input makes it equal to the lowercase name only for the same letter.
+*/
+
+static constexpr size_t s_allergenSlotsCount = 16;
+static constexpr size_t s_maxAllergenNameLength = 12; // strawberries
+
+struct AllergenSlot
+{
+    const char* name;
+    size_t length;
+    uint8_t bit;
+};
+
+constexpr size_t NameLength(const char* name)
+{
+    size_t length = 0;
+    while (name[length] != '\0')
+    {
+        ++length;
+    }
+    return length;
+}
+
+constexpr uint32_t AllergenNameHash(size_t length, char first, char last, uint32_t multiplier)
+{
+    const uint32_t key = ((static_cast<uint8_t>(first) | 0x20u) << 8) ^ ((static_cast<uint8_t>(last) | 0x20u) << 4)
+                       ^ static_cast<uint32_t>(length);
+    return (key * multiplier) >> 28;
+}
+
+constexpr uint32_t FindAllergenNameMultiplier()
+{
+    for (uint32_t multiplier = 0x9E3779B1u;; multiplier += 2)
+    {
+        bool used[s_allergenSlotsCount] = {};
+        bool unique = true;
+        for (const char* name : s_allergenNames)
+        {
+            const size_t length = NameLength(name);
+            const uint32_t slot = AllergenNameHash(length, name[0], name[length - 1], multiplier);
+            unique = unique && !used[slot];
+            used[slot] = true;
+        }
+        if (unique)
+        {
+            return multiplier;
+        }
+    }
+}
+
+static constexpr uint32_t s_allergenNameMultiplier = FindAllergenNameMultiplier();
+
+constexpr std::array<AllergenSlot, s_allergenSlotsCount> MakeAllergenSlots()
+{
+    std::array<AllergenSlot, s_allergenSlotsCount> slots = {};
+    for (auto& slot : slots)
+    {
+        slot = {"", 0, 0};
+    }
+    for (size_t index = 0; index < s_allergensCount; ++index)
+    {
+        const char* name = s_allergenNames[index];
+        const size_t length = NameLength(name);
+        slots[AllergenNameHash(length, name[0], name[length - 1], s_allergenNameMultiplier)] =
+            {name, length, static_cast<uint8_t>(1u << index)};
+    }
+    return slots;
+}
+
+static constexpr std::array<AllergenSlot, s_allergenSlotsCount> s_allergenSlots = MakeAllergenSlots();
+
+// Bit of the allergen with the given name in any case, 0 for unknown names
+inline uint8_t AllergenBit(std::string_view name)
+{
+    // Empty name wraps around and is rejected too
+    if (name.size() - 1 >= s_maxAllergenNameLength)
+    {
+        return 0;
+    }
+    const AllergenSlot& slot = s_allergenSlots[AllergenNameHash(name.size(), name.front(), name.back(),
+                                                                s_allergenNameMultiplier)];
+    if (slot.length != name.size())
+    {
+        return 0;
+    }
+    unsigned difference = 0;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        difference |= (static_cast<uint8_t>(name[i]) | 0x20u) ^ static_cast<uint8_t>(slot.name[i]);
+    }
+    return difference == 0 ? slot.bit : 0;
+}
+
+// Allergens of the mask from eggs to cats
+class AllergenList
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Allergen;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Allergen*;
+        using reference = Allergen;
+
+        explicit Iterator(uint8_t rest)
+            : m_rest(rest)
+        { }
+
+        Allergen operator*() const
+        {
+            return static_cast<Allergen>(m_rest & -m_rest);
+        }
+
+        Iterator& operator++()
+        {
+            m_rest &= m_rest - 1;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return m_rest == other.m_rest;
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+            return m_rest != other.m_rest;
+        }
+
+    private:
+        uint8_t m_rest;
+    };
+
+    explicit AllergenList(uint8_t mask)
+        : m_mask(mask)
+    { }
+
+    Iterator begin() const
+    {
+        return Iterator(m_mask);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(0);
+    }
+
+    bool empty() const
+    {
+        return m_mask == 0;
+    }
+
+    size_t size() const
+    {
+        size_t result = 0;
+        for (uint8_t rest = m_mask; rest != 0; rest &= rest - 1)
+        {
+            ++result;
+        }
+        return result;
+    }
+
+private:
+    uint8_t m_mask;
+};
+
+class Allergies
+{
+public:
+    // Components of the score above cats (128) are ignored
+    explicit Allergies(unsigned score)
+        : m_mask(static_cast<uint8_t>(score & 0xFF))
+    { }
+
+    bool IsAllergicTo(Allergen allergen) const
+    {
+        return (m_mask & static_cast<uint8_t>(allergen)) != 0;
+    }
+
+    // Name of the allergen in any case, false for unknown names
+    bool IsAllergicTo(std::string_view name) const
+    {
+        return (m_mask & AllergenBit(name)) != 0;
+    }
+
+    AllergenList List() const
+    {
+        return AllergenList(m_mask);
+    }
+
+    uint8_t Mask() const
+    {
+        return m_mask;
+    }
+
+private:
+    uint8_t m_mask;
+};
+
+// Number of scores with every allergen, indexed by AllergenIndex
+using AllergenCounts = std::array<uint64_t, s_allergensCount>;
+
+// Byte by byte reference implementation
+AllergenCounts CountAllergensScalar(const uint8_t* scores, size_t count)
+{
+    AllergenCounts counts = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t bit = 0; bit < s_allergensCount; ++bit)
+        {
+            counts[bit] += (scores[i] >> bit) & 1;
+        }
+    }
+    return counts;
+}
+
+AllergenCounts CountAllergens(const uint8_t* scores, size_t count)
+{
+#ifdef ALLERGIES_SSE2
+    AllergenCounts counts = {};
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i zero = _mm_setzero_si128();
+    // Byte counters overflow after 255 blocks
+    const size_t blocksPerFlush = 255;
+
+    size_t pos = 0;
+    while (pos + 16 <= count)
+    {
+        __m128i accumulators[s_allergensCount];
+        for (__m128i& accumulator : accumulators)
+        {
+            accumulator = zero;
+        }
+        for (size_t block = 0; block < blocksPerFlush && pos + 16 <= count; ++block, pos += 16)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + pos));
+            for (size_t bit = 0; bit < s_allergensCount; ++bit)
+            {
+                const __m128i bits = _mm_and_si128(_mm_srli_epi16(bytes, static_cast<int>(bit)), one);
+                accumulators[bit] = _mm_add_epi8(accumulators[bit], bits);
+            }
+        }
+        for (size_t bit = 0; bit < s_allergensCount; ++bit)
+        {
+            const __m128i sums = _mm_sad_epu8(accumulators[bit], zero);
+            counts[bit] += static_cast<uint64_t>(_mm_cvtsi128_si32(sums))
+                         + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+        }
+    }
+
+    const AllergenCounts tail = CountAllergensScalar(scores + pos, count - pos);
+    for (size_t bit = 0; bit < s_allergensCount; ++bit)
+    {
+        counts[bit] += tail[bit];
+    }
+    return counts;
+#else
+    return CountAllergensScalar(scores, count);
+#endif
+}
+
+/*
+ * Population statistics:
+ * a score is a byte, so all statistics of a scores array are derived from its histogram of 256 bins.
+ * Every worker builds the histogram of its part of the array, the histograms are summed at the end.
+ * Inside the worker four interleaved sub-histograms are used, so neighbouring equal scores
+ * don't wait for the previous increment of the same counter.
+*/
+
+using ScoreHistogram = std::array<uint64_t, 256>;
+
+struct AllergyProfile
+{
+    uint8_t mask;
+    uint64_t count;
+
+    bool operator==(const AllergyProfile& other) const
+    {
+        return mask == other.mask && count == other.count;
+    }
+};
+
+struct AllergenStatistics
+{
+    uint64_t total = 0;
+    // Number of scores with the allergen, indexed by AllergenIndex
+    AllergenCounts marginals = {};
+    // Number of scores with both allergens, the diagonal is equal to marginals
+    std::array<AllergenCounts, s_allergensCount> cooccurrence = {};
+};
+
+ScoreHistogram BuildHistogram(const uint8_t* scores, size_t count)
+{
+    // 32-bit counters are flushed before they can overflow
+    const size_t maxBatch = size_t(1) << 31;
+    ScoreHistogram histogram = {};
+    while (count != 0)
+    {
+        const size_t batch = std::min(count, maxBatch);
+        std::vector<uint32_t> partial(4 * 256, 0);
+        size_t i = 0;
+        for (; i + 4 <= batch; i += 4)
+        {
+            ++partial[scores[i]];
+            ++partial[256 + scores[i + 1]];
+            ++partial[512 + scores[i + 2]];
+            ++partial[768 + scores[i + 3]];
+        }
+        for (; i < batch; ++i)
+        {
+            ++partial[scores[i]];
+        }
+        for (size_t bin = 0; bin < 256; ++bin)
+        {
+            histogram[bin] += uint64_t(partial[bin]) + partial[256 + bin] + partial[512 + bin] + partial[768 + bin];
+        }
+        scores += batch;
+        count -= batch;
+    }
+    return histogram;
+}
+
+size_t DefaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+ScoreHistogram BuildHistogramParallel(const uint8_t* scores, size_t count, size_t threadCount = DefaultThreadCount())
+{
+    const size_t workers = std::max<size_t>(1, std::min(threadCount, count));
+    const size_t chunkSize = (count + workers - 1) / workers;
+    std::vector<ScoreHistogram> histograms(workers);
+
+    auto build = [&](size_t worker)
+    {
+        const size_t begin = std::min(count, worker * chunkSize);
+        const size_t end = std::min(count, begin + chunkSize);
+        histograms[worker] = BuildHistogram(scores + begin, end - begin);
+    };
+    std::vector<std::thread> threads;
+    for (size_t worker = 1; worker < workers; ++worker)
+    {
+        threads.emplace_back(build, worker);
+    }
+    build(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    ScoreHistogram result = {};
+    for (const ScoreHistogram& histogram : histograms)
+    {
+        for (size_t bin = 0; bin < result.size(); ++bin)
+        {
+            result[bin] += histogram[bin];
+        }
+    }
+    return result;
+}
+
+AllergenStatistics ComputeStatistics(const ScoreHistogram& histogram)
+{
+    AllergenStatistics statistics;
+    for (unsigned mask = 0; mask < histogram.size(); ++mask)
+    {
+        const uint64_t count = histogram[mask];
+        statistics.total += count;
+        for (size_t first = 0; first < s_allergensCount; ++first)
+        {
+            if ((mask >> first & 1) == 0)
+            {
+                continue;
+            }
+            statistics.marginals[first] += count;
+            for (size_t second = 0; second < s_allergensCount; ++second)
+            {
+                statistics.cooccurrence[first][second] += (mask >> second & 1) * count;
+            }
+        }
+    }
+    return statistics;
+}
+
+// Up to k most common full allergy profiles, most common first, profiles nobody has are skipped
+std::vector<AllergyProfile> MostCommonProfiles(const ScoreHistogram& histogram, size_t k)
+{
+    std::vector<AllergyProfile> profiles;
+    for (unsigned mask = 0; mask < histogram.size(); ++mask)
+    {
+        if (histogram[mask] != 0)
+        {
+            profiles.push_back({static_cast<uint8_t>(mask), histogram[mask]});
+        }
+    }
+    std::sort(profiles.begin(), profiles.end(), [](const AllergyProfile& left, const AllergyProfile& right)
+    {
+        return left.count != right.count ? left.count > right.count : left.mask < right.mask;
+    });
+    profiles.resize(std::min(k, profiles.size()));
+    return profiles;
+}
+
+std::vector<Allergen> ToVector(const AllergenList& list)
+{
+    return std::vector<Allergen>(list.begin(), list.end());
+}
+
+TEST(Allergies, NoAllergies)
+{
+    Allergies allergies(0);
+    EXPECT_FALSE(allergies.IsAllergicTo(Allergen::Eggs));
+    EXPECT_TRUE(allergies.List().empty());
+}
+
+TEST(Allergies, SingleAllergy)
+{
+    Allergies allergies(1);
+    EXPECT_TRUE(allergies.IsAllergicTo(Allergen::Eggs));
+    EXPECT_FALSE(allergies.IsAllergicTo(Allergen::Peanuts));
+}
+
+TEST(Allergies, HigherComponentsIgnored)
+{
+    Allergies allergies(257);
+    EXPECT_EQ(std::vector<Allergen>({Allergen::Eggs}), ToVector(allergies.List()));
+}
+
+TEST(Allergies, AllAllergies)
+{
+    Allergies allergies(255);
+    EXPECT_EQ(8u, allergies.List().size());
+    EXPECT_EQ(std::vector<Allergen>({Allergen::Eggs, Allergen::Peanuts, Allergen::Shellfish, Allergen::Strawberries,
+                                     Allergen::Tomatoes, Allergen::Chocolate, Allergen::Pollen, Allergen::Cats}),
+              ToVector(allergies.List()));
+}
+
+TEST(Allergies, Names)
+{
+    EXPECT_STREQ("eggs", AllergenName(Allergen::Eggs));
+    EXPECT_STREQ("strawberries", AllergenName(Allergen::Strawberries));
+    EXPECT_STREQ("cats", AllergenName(Allergen::Cats));
+}
+
+TEST(Allergies, Acceptance)
+{
+    Allergies tom(34);
+    EXPECT_TRUE(tom.IsAllergicTo(Allergen::Peanuts));
+    EXPECT_TRUE(tom.IsAllergicTo(Allergen::Chocolate));
+    EXPECT_FALSE(tom.IsAllergicTo(Allergen::Cats));
+    EXPECT_EQ(std::vector<Allergen>({Allergen::Peanuts, Allergen::Chocolate}), ToVector(tom.List()));
+}
+
+TEST(AllergenBit, AllNames)
+{
+    for (size_t index = 0; index < s_allergensCount; ++index)
+    {
+        EXPECT_EQ(1u << index, AllergenBit(s_allergenNames[index])) << s_allergenNames[index];
+    }
+}
+
+TEST(AllergenBit, IgnoresCase)
+{
+    EXPECT_EQ(static_cast<uint8_t>(Allergen::Shellfish), AllergenBit("ShellFish"));
+    EXPECT_EQ(static_cast<uint8_t>(Allergen::Strawberries), AllergenBit("STRAWBERRIES"));
+}
+
+TEST(AllergenBit, UnknownNames)
+{
+    for (const char* name : {"", "dust", "egg", "eggs ", "cat", "pollens", "chocolatechocolate", "c@ts", "peanut5"})
+    {
+        EXPECT_EQ(0u, AllergenBit(name)) << name;
+    }
+    EXPECT_EQ(0u, AllergenBit(std::string_view("eggs\0", 5)));
+}
+
+TEST(Allergies, IsAllergicToName)
+{
+    Allergies tom(34);
+    EXPECT_TRUE(tom.IsAllergicTo("peanuts"));
+    EXPECT_TRUE(tom.IsAllergicTo("Chocolate"));
+    EXPECT_FALSE(tom.IsAllergicTo("cats"));
+    EXPECT_FALSE(tom.IsAllergicTo("dust"));
+}
+
+TEST(CountAllergens, Empty)
+{
+    EXPECT_EQ(AllergenCounts(), CountAllergens(nullptr, 0));
+}
+
+TEST(CountAllergens, FewScores)
+{
+    const uint8_t scores[] = {34, 1, 255};
+    EXPECT_EQ(AllergenCounts({2, 2, 1, 1, 1, 2, 1, 1}), CountAllergens(scores, 3));
+}
+
+TEST(CountAllergens, MatchesScalarReference)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> score(0, 255);
+    for (size_t count : {15u, 16u, 17u, 255u * 16u, 255u * 16u + 1u, 100000u})
+    {
+        std::vector<uint8_t> scores(count);
+        for (uint8_t& s : scores)
+        {
+            s = static_cast<uint8_t>(score(random));
+        }
+        EXPECT_EQ(CountAllergensScalar(scores.data(), count), CountAllergens(scores.data(), count)) << count;
+    }
+}
+
+TEST(CountAllergens, CountersDoNotOverflow)
+{
+    const std::vector<uint8_t> scores(100000, 255);
+    AllergenCounts expected;
+    expected.fill(100000);
+    EXPECT_EQ(expected, CountAllergens(scores.data(), scores.size()));
+}
+
+TEST(BuildHistogram, Empty)
+{
+    EXPECT_EQ(ScoreHistogram(), BuildHistogram(nullptr, 0));
+    EXPECT_EQ(ScoreHistogram(), BuildHistogramParallel(nullptr, 0, 4));
+}
+
+TEST(BuildHistogram, CountsEveryScore)
+{
+    const uint8_t scores[] = {34, 1, 34, 255, 0};
+    ScoreHistogram expected = {};
+    expected[34] = 2;
+    expected[1] = 1;
+    expected[255] = 1;
+    expected[0] = 1;
+    EXPECT_EQ(expected, BuildHistogram(scores, 5));
+}
+
+TEST(BuildHistogramParallel, MatchesSingleThread)
+{
+    std::mt19937 random(42);
+    std::vector<uint8_t> scores(100003);
+    for (uint8_t& s : scores)
+    {
+        s = static_cast<uint8_t>(random() % 7 == 0 ? 34 : random());
+    }
+    const ScoreHistogram expected = BuildHistogram(scores.data(), scores.size());
+    for (size_t threads = 1; threads <= 8; ++threads)
+    {
+        EXPECT_EQ(expected, BuildHistogramParallel(scores.data(), scores.size(), threads)) << threads;
+    }
+}
+
+TEST(ComputeStatistics, MarginalsMatchCountAllergens)
+{
+    std::mt19937 random(42);
+    std::vector<uint8_t> scores(10000);
+    for (uint8_t& s : scores)
+    {
+        s = static_cast<uint8_t>(random());
+    }
+    const AllergenStatistics statistics = ComputeStatistics(BuildHistogram(scores.data(), scores.size()));
+    EXPECT_EQ(scores.size(), statistics.total);
+    EXPECT_EQ(CountAllergens(scores.data(), scores.size()), statistics.marginals);
+    for (size_t allergen = 0; allergen < s_allergensCount; ++allergen)
+    {
+        EXPECT_EQ(statistics.marginals[allergen], statistics.cooccurrence[allergen][allergen]);
+    }
+}
+
+TEST(ComputeStatistics, Cooccurrence)
+{
+    const uint8_t scores[] = {34, 34, 2, 1 | 128};
+    const AllergenStatistics statistics = ComputeStatistics(BuildHistogram(scores, 4));
+    const size_t peanuts = AllergenIndex(Allergen::Peanuts);
+    const size_t chocolate = AllergenIndex(Allergen::Chocolate);
+    const size_t eggs = AllergenIndex(Allergen::Eggs);
+    const size_t cats = AllergenIndex(Allergen::Cats);
+    EXPECT_EQ(2u, statistics.cooccurrence[peanuts][chocolate]);
+    EXPECT_EQ(2u, statistics.cooccurrence[chocolate][peanuts]);
+    EXPECT_EQ(3u, statistics.cooccurrence[peanuts][peanuts]);
+    EXPECT_EQ(1u, statistics.cooccurrence[eggs][cats]);
+    EXPECT_EQ(0u, statistics.cooccurrence[eggs][peanuts]);
+}
+
+TEST(MostCommonProfiles, SortedByCount)
+{
+    const uint8_t scores[] = {34, 2, 34, 0, 2, 34, 5};
+    const std::vector<AllergyProfile> expected = {{34, 3}, {2, 2}};
+    EXPECT_EQ(expected, MostCommonProfiles(BuildHistogram(scores, 7), 2));
+    EXPECT_EQ(4u, MostCommonProfiles(BuildHistogram(scores, 7), 10).size());
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(CountAllergens, DISABLED_Benchmark)
+{
+    std::vector<uint8_t> scores(256 << 20);
+    std::mt19937 random(42);
+    for (uint8_t& s : scores)
+    {
+        s = static_cast<uint8_t>(random());
+    }
+
+    auto measure = [&scores](const char* name, AllergenCounts (*count)(const uint8_t*, size_t))
+    {
+        auto begin = std::chrono::steady_clock::now();
+        const AllergenCounts counts = count(scores.data(), scores.size());
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": " << scores.size() / seconds / (1 << 30) << " GB/s, eggs " << counts[0] << std::endl;
+    };
+    measure("scalar", CountAllergensScalar);
+    measure("sse2", CountAllergens);
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(BuildHistogramParallel, DISABLED_Benchmark)
+{
+    std::vector<uint8_t> scores(size_t(1) << 30);
+    std::mt19937 random(42);
+    for (uint8_t& s : scores)
+    {
+        s = static_cast<uint8_t>(random());
+    }
+
+    for (size_t threads = 1; threads <= std::max<size_t>(DefaultThreadCount(), 4); threads *= 2)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        const ScoreHistogram histogram = BuildHistogramParallel(scores.data(), scores.size(), threads);
+        const AllergenStatistics statistics = ComputeStatistics(histogram);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << threads << " thread(s): " << scores.size() / seconds / (1 << 30) << " GB/s, "
+                  << statistics.total << " records" << std::endl;
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(AllergenBit, DISABLED_Benchmark)
+{
+    std::vector<std::string> queries(10000000);
+    std::mt19937 random(42);
+    for (std::string& query : queries)
+    {
+        const size_t index = random() % (s_allergensCount + 1);
+        query = index < s_allergensCount ? s_allergenNames[index] : "dust";
+        for (char& c : query)
+        {
+            c = random() % 2 ? static_cast<char>(c - 'a' + 'A') : c;
+        }
+    }
+
+    std::map<std::string, uint8_t> map;
+    std::unordered_map<std::string, uint8_t> unorderedMap;
+    for (size_t index = 0; index < s_allergensCount; ++index)
+    {
+        map[s_allergenNames[index]] = static_cast<uint8_t>(1u << index);
+        unorderedMap[s_allergenNames[index]] = static_cast<uint8_t>(1u << index);
+    }
+
+    auto measure = [&queries](const char* name, auto lookup)
+    {
+        unsigned checksum = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (const std::string& query : queries)
+        {
+            checksum += lookup(query);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": " << seconds * 1e9 / queries.size() << " ns per lookup, checksum " << checksum << std::endl;
+    };
+    auto lowercase = [](std::string name)
+    {
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+        return name;
+    };
+
+    measure("perfect hash", [](const std::string& query) { return AllergenBit(query); });
+    measure("std::map", [&](const std::string& query)
+    {
+        auto found = map.find(lowercase(query));
+        return found != map.end() ? found->second : 0;
+    });
+    measure("std::unordered_map", [&](const std::string& query)
+    {
+        auto found = unorderedMap.find(lowercase(query));
+        return found != unorderedMap.end() ? found->second : 0;
+    });
+}
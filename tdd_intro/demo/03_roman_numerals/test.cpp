@@ -17,4 +17,624 @@ In Roman numerals 1990 is MCMXC:
 1998 is written as MCMXCVIII.
 */
 
-#include <gtest/gtest.h>
\ No newline at end of file
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Architecture:
+ * Numerals for every value from 1 to 3999 are generated at compile time into a table.
+ * Entries are padded to 16 bytes, so conversion is one fixed-size copy from the table
+ * into the caller buffer followed by the table length lookup, without any allocation.
+ * Entry 0 is an empty numeral, it is used for the values out of range.
+*/
+
+static constexpr unsigned s_maxRoman = 3999;
+static constexpr size_t s_maxRomanLength = 15; // MMMDCCCLXXXVIII
+// Size of the buffer for a single numeral, the whole padded table entry is copied there
+static constexpr size_t s_romanBufferSize = 16;
+
+struct RomanTable
+{
+    char text[s_maxRoman + 1][s_romanBufferSize];
+    uint8_t length[s_maxRoman + 1];
+};
+
+constexpr RomanTable MakeRomanTable()
+{
+    const unsigned values[] = {1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1};
+    const char* const symbols[] = {"M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I"};
+
+    RomanTable table = {};
+    for (unsigned value = 1; value <= s_maxRoman; ++value)
+    {
+        unsigned rest = value;
+        uint8_t length = 0;
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+        {
+            for (; rest >= values[i]; rest -= values[i])
+            {
+                for (const char* symbol = symbols[i]; *symbol != '\0'; ++symbol)
+                {
+                    table.text[value][length++] = *symbol;
+                }
+            }
+        }
+        table.length[value] = length;
+    }
+    return table;
+}
+
+static constexpr RomanTable s_romanTable = MakeRomanTable();
+
+// Writes numeral of the value to the buffer of s_romanBufferSize bytes and returns its length.
+// Values out of 1..3999 give empty numeral.
+inline size_t ToRoman(unsigned value, char* buffer)
+{
+    const unsigned index = value <= s_maxRoman ? value : 0;
+    std::memcpy(buffer, s_romanTable.text[index], s_romanBufferSize);
+    return s_romanTable.length[index];
+}
+
+std::string ToRoman(unsigned value)
+{
+    char buffer[s_romanBufferSize];
+    return std::string(buffer, ToRoman(value, buffer));
+}
+
+// Size of the output buffer required by ToRomanBatch for given number of values
+constexpr size_t RomanBatchCapacity(size_t count)
+{
+    return count * s_maxRomanLength + (s_romanBufferSize - s_maxRomanLength);
+}
+
+// Converts values into numerals packed one after another into output of RomanBatchCapacity(count) bytes.
+// Offsets receive count + 1 entries: numeral i occupies [offsets[i], offsets[i + 1]) of output.
+// Returns total length of the numerals.
+size_t ToRomanBatch(const unsigned* values, size_t count, char* output, size_t* offsets)
+{
+    size_t position = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        offsets[i] = position;
+        position += ToRoman(values[i], output + position);
+    }
+    offsets[count] = position;
+    return position;
+}
+
+/*
+ * Roman to integer:
+ * strict parser accepts only the canonical numerals produced by ToRoman, e.g. IIII, VX, IL, CMC are rejected.
+ * It is a DFA over the seven symbols generated at compile time. State is the decimal place
+ * (thousands, hundreds, tens, units) and the position inside its digit (I, II, III, V, VI, VII, VIII,
+ * or the complete IV/IX). Every transition also carries the value it adds, e.g. X after I adds 8,
+ * so validation and conversion are done by the same table lookups in one pass.
+*/
+
+static constexpr uint8_t s_romanSymbols = 8; // I V X L C D M and any other character
+static constexpr uint8_t s_romanInvalidSymbol = 7;
+static constexpr uint8_t s_romanDigitStates = 9;
+static constexpr uint8_t s_romanInitialState = 4 * s_romanDigitStates;
+static constexpr uint8_t s_romanRejectState = s_romanInitialState + 1;
+static constexpr uint8_t s_romanStates = s_romanRejectState + 1;
+
+// Position inside the digit of the decimal place
+enum RomanDigitState : uint8_t
+{
+    RomanOne = 1,
+    RomanTwo,
+    RomanThree,
+    RomanFive,
+    RomanFiveOne,
+    RomanFiveTwo,
+    RomanFiveThree,
+    RomanComplete
+};
+
+struct RomanDfa
+{
+    uint8_t symbol[256];
+    uint8_t next[s_romanStates][s_romanSymbols];
+    uint16_t add[s_romanStates][s_romanSymbols];
+    bool accepting[s_romanStates];
+};
+
+constexpr RomanDfa MakeRomanDfa()
+{
+    RomanDfa dfa = {};
+    const char symbols[] = "IVXLCDM";
+    for (unsigned c = 0; c < 256; ++c)
+    {
+        dfa.symbol[c] = s_romanInvalidSymbol;
+    }
+    for (uint8_t i = 0; i < s_romanInvalidSymbol; ++i)
+    {
+        dfa.symbol[static_cast<unsigned char>(symbols[i])] = i;
+    }
+
+    // Symbols for one, five and ten units of every decimal place, -1 if there is no such symbol
+    const int one[] = {0, 2, 4, 6};
+    const int five[] = {1, 3, 5, -1};
+    const int ten[] = {2, 4, 6, -1};
+    const uint16_t unit[] = {1, 10, 100, 1000};
+
+    for (uint8_t state = 0; state < s_romanStates; ++state)
+    {
+        for (uint8_t symbol = 0; symbol < s_romanSymbols; ++symbol)
+        {
+            dfa.next[state][symbol] = s_romanRejectState;
+        }
+    }
+
+    for (uint8_t state = 0; state < s_romanInitialState + 1; ++state)
+    {
+        const uint8_t place = state / s_romanDigitStates;
+        const uint8_t digit = state % s_romanDigitStates;
+        if (state != s_romanInitialState && digit == 0)
+        {
+            continue;
+        }
+        dfa.accepting[state] = state != s_romanInitialState;
+
+        // Any lower decimal place can follow
+        for (uint8_t lower = 0; lower < place; ++lower)
+        {
+            const uint8_t base = lower * s_romanDigitStates;
+            dfa.next[state][one[lower]] = base + RomanOne;
+            dfa.add[state][one[lower]] = unit[lower];
+            if (five[lower] >= 0)
+            {
+                dfa.next[state][five[lower]] = base + RomanFive;
+                dfa.add[state][five[lower]] = 5 * unit[lower];
+            }
+        }
+        if (state == s_romanInitialState)
+        {
+            continue;
+        }
+
+        // Continuation of the current digit
+        const uint8_t base = place * s_romanDigitStates;
+        const uint8_t repeated[] = {0, RomanTwo, RomanThree, 0, RomanFiveOne, RomanFiveTwo, RomanFiveThree, 0, 0};
+        if (repeated[digit] != 0)
+        {
+            dfa.next[state][one[place]] = base + repeated[digit];
+            dfa.add[state][one[place]] = unit[place];
+        }
+        if (digit == RomanOne && five[place] >= 0)
+        {
+            dfa.next[state][five[place]] = base + RomanComplete;
+            dfa.add[state][five[place]] = 3 * unit[place];
+            dfa.next[state][ten[place]] = base + RomanComplete;
+            dfa.add[state][ten[place]] = 8 * unit[place];
+        }
+    }
+    return dfa;
+}
+
+static constexpr RomanDfa s_romanDfa = MakeRomanDfa();
+
+// Value of the canonical numeral or 0 if the numeral is malformed
+unsigned FromRoman(std::string_view numeral)
+{
+    uint8_t state = s_romanInitialState;
+    unsigned value = 0;
+    for (char c : numeral)
+    {
+        const uint8_t symbol = s_romanDfa.symbol[static_cast<unsigned char>(c)];
+        value += s_romanDfa.add[state][symbol];
+        state = s_romanDfa.next[state][symbol];
+    }
+    return s_romanDfa.accepting[state] ? value : 0;
+}
+
+// Values of newline separated numerals, 0 for malformed ones. Windows line endings are accepted too.
+std::vector<unsigned> FromRomanLines(std::string_view text)
+{
+    std::vector<unsigned> values;
+    while (!text.empty())
+    {
+        const size_t lineEnd = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, lineEnd);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        values.push_back(FromRoman(line));
+        text.remove_prefix(std::min(lineEnd + 1, text.size()));
+    }
+    return values;
+}
+
+/*
+ * Extended range (vinculum):
+ * overline multiplies the symbol by 1000. In text the overlined symbol is preceded by '_',
+ * e.g. _V is 5000 and _M is 1000000. Values below 4000 are written as usual, larger values
+ * are the overlined numeral of the thousands followed by the usual numeral of the rest:
+ * 4001 is _I_VI, 3999999 is _M_M_M_C_M_X_C_I_XCMXCIX.
+ * Numerals are written to a sink - any callable taking (const char* data, size_t size) -
+ * with a single call per numeral from a fixed buffer on the stack.
+*/
+
+static constexpr unsigned s_maxRomanExtended = s_maxRoman * 1000 + 999;
+static constexpr size_t s_maxRomanExtendedLength = 42; // _M_M_M_D_C_C_C_L_X_X_X_V_I_I_IDCCCLXXXVIII
+
+// Writes extended numeral of the value to the sink. Nothing is written for values out of 1..3999999.
+template<typename Sink>
+void WriteRomanExtended(unsigned value, Sink&& sink)
+{
+    char buffer[s_maxRomanExtendedLength + s_romanBufferSize];
+    size_t length = 0;
+    if (value > s_maxRoman && value <= s_maxRomanExtended)
+    {
+        const unsigned thousands = value / 1000;
+        for (size_t i = 0; i < s_romanTable.length[thousands]; ++i)
+        {
+            buffer[length++] = '_';
+            buffer[length++] = s_romanTable.text[thousands][i];
+        }
+        value %= 1000;
+    }
+    length += ToRoman(value, buffer + length);
+    if (length != 0)
+    {
+        sink(static_cast<const char*>(buffer), length);
+    }
+}
+
+std::string ToRomanExtended(unsigned value)
+{
+    std::string result;
+    WriteRomanExtended(value, [&result](const char* data, size_t size) { result.append(data, size); });
+    return result;
+}
+
+// Value of the canonical extended numeral or 0 if the numeral is malformed
+unsigned FromRomanExtended(std::string_view numeral)
+{
+    char overlined[s_maxRomanLength];
+    size_t overlinedLength = 0;
+    while (!numeral.empty() && numeral.front() == '_')
+    {
+        if (numeral.size() < 2 || overlinedLength == s_maxRomanLength)
+        {
+            return 0;
+        }
+        overlined[overlinedLength++] = numeral[1];
+        numeral.remove_prefix(2);
+    }
+    if (overlinedLength == 0)
+    {
+        return FromRoman(numeral);
+    }
+
+    // Thousands below 4 are written with M, the rest must be below 1000
+    const unsigned thousands = FromRoman(std::string_view(overlined, overlinedLength));
+    const unsigned rest = numeral.empty() ? 0 : FromRoman(numeral);
+    if (thousands < 4 || (!numeral.empty() && (rest == 0 || rest >= 1000)))
+    {
+        return 0;
+    }
+    return thousands * 1000 + rest;
+}
+
+// Straightforward greedy conversion, the reference for tests and the baseline for benchmark
+std::string ToRomanNaive(unsigned value)
+{
+    static const unsigned s_values[] = {1000, 900, 500, 400, 100, 90, 50, 40, 10, 9, 5, 4, 1};
+    static const char* const s_symbols[] = {"M", "CM", "D", "CD", "C", "XC", "L", "XL", "X", "IX", "V", "IV", "I"};
+    std::string result;
+    if (value > s_maxRoman)
+    {
+        return result;
+    }
+    for (size_t i = 0; i < sizeof(s_values) / sizeof(s_values[0]); ++i)
+    {
+        for (; value >= s_values[i]; value -= s_values[i])
+        {
+            result += s_symbols[i];
+        }
+    }
+    return result;
+}
+
+TEST(ToRoman, One)
+{
+    EXPECT_EQ("I", ToRoman(1));
+}
+
+TEST(ToRoman, Subtractive)
+{
+    EXPECT_EQ("IV", ToRoman(4));
+    EXPECT_EQ("IX", ToRoman(9));
+    EXPECT_EQ("XL", ToRoman(40));
+    EXPECT_EQ("CD", ToRoman(400));
+}
+
+TEST(ToRoman, OutOfRange)
+{
+    EXPECT_EQ("", ToRoman(0));
+    EXPECT_EQ("", ToRoman(4000));
+}
+
+TEST(ToRoman, Longest)
+{
+    EXPECT_EQ("MMMDCCCLXXXVIII", ToRoman(3888));
+    EXPECT_EQ(s_maxRomanLength, ToRoman(3888).size());
+}
+
+TEST(ToRoman, Acceptance)
+{
+    EXPECT_EQ("MCMXC", ToRoman(1990));
+    EXPECT_EQ("MMVIII", ToRoman(2008));
+    EXPECT_EQ("MCMXCVIII", ToRoman(1998));
+    EXPECT_EQ("MMMCMXCIX", ToRoman(3999));
+}
+
+TEST(ToRoman, MatchesNaiveForAllValues)
+{
+    for (unsigned value = 0; value <= s_maxRoman + 1; ++value)
+    {
+        ASSERT_EQ(ToRomanNaive(value), ToRoman(value)) << value;
+    }
+}
+
+TEST(ToRomanBatch, Empty)
+{
+    size_t offsets[1] = {42};
+    char output[RomanBatchCapacity(0)];
+    EXPECT_EQ(0u, ToRomanBatch(nullptr, 0, output, offsets));
+    EXPECT_EQ(0u, offsets[0]);
+}
+
+TEST(ToRomanBatch, PackedOutput)
+{
+    const std::vector<unsigned> values = {1990, 0, 4, 3888};
+    std::vector<char> output(RomanBatchCapacity(values.size()));
+    std::vector<size_t> offsets(values.size() + 1);
+    const size_t length = ToRomanBatch(values.data(), values.size(), output.data(), offsets.data());
+
+    EXPECT_EQ("MCMXCIVMMMDCCCLXXXVIII", std::string(output.data(), length));
+    EXPECT_EQ(std::vector<size_t>({0, 5, 5, 7, 22}), offsets);
+}
+
+TEST(FromRoman, Acceptance)
+{
+    EXPECT_EQ(1u, FromRoman("I"));
+    EXPECT_EQ(4u, FromRoman("IV"));
+    EXPECT_EQ(1990u, FromRoman("MCMXC"));
+    EXPECT_EQ(2008u, FromRoman("MMVIII"));
+    EXPECT_EQ(1998u, FromRoman("MCMXCVIII"));
+    EXPECT_EQ(3999u, FromRoman("MMMCMXCIX"));
+}
+
+TEST(FromRoman, Malformed)
+{
+    for (const char* numeral : {"", "IIII", "VX", "IL", "IC", "XM", "VV", "DD", "MMMM", "CMC", "IXI", "IIV", "XCX",
+                                "VIIII", "iv", "MCMXCIVA", " I"})
+    {
+        EXPECT_EQ(0u, FromRoman(numeral)) << numeral;
+    }
+}
+
+TEST(FromRoman, RoundTripAllValues)
+{
+    for (unsigned value = 1; value <= s_maxRoman; ++value)
+    {
+        ASSERT_EQ(value, FromRoman(ToRoman(value))) << value;
+    }
+}
+
+// Every string of Roman symbols is either a canonical numeral of some value or is rejected
+TEST(FromRoman, AllShortSymbolStrings)
+{
+    const char symbols[] = "IVXLCDM";
+    std::string numeral;
+    for (size_t length = 1; length <= 6; ++length)
+    {
+        numeral.assign(length, 'I');
+        std::vector<size_t> digits(length, 0);
+        for (;;)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                numeral[i] = symbols[digits[i]];
+            }
+            const unsigned value = FromRoman(numeral);
+            ASSERT_EQ(value != 0 ? numeral : "", ToRoman(value)) << numeral;
+
+            size_t position = 0;
+            while (position < length && ++digits[position] == 7)
+            {
+                digits[position++] = 0;
+            }
+            if (position == length)
+            {
+                break;
+            }
+        }
+    }
+}
+
+TEST(FromRoman, RandomStrings)
+{
+    const char symbols[] = "IVXLCDM";
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> length(1, s_maxRomanLength + 1);
+    std::uniform_int_distribution<size_t> symbol(0, 6);
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        std::string numeral(length(random), 'I');
+        for (char& c : numeral)
+        {
+            c = symbols[symbol(random)];
+        }
+        const unsigned value = FromRoman(numeral);
+        ASSERT_EQ(value != 0 ? numeral : "", ToRoman(value)) << numeral;
+    }
+}
+
+TEST(FromRomanLines, Empty)
+{
+    EXPECT_TRUE(FromRomanLines("").empty());
+}
+
+TEST(FromRomanLines, SeveralLines)
+{
+    EXPECT_EQ(std::vector<unsigned>({1990, 0, 4, 0, 2008}), FromRomanLines("MCMXC\nIIII\r\nIV\n\nMMVIII\n"));
+}
+
+TEST(ToRomanExtended, UsualBelow4000)
+{
+    EXPECT_EQ("MMMCMXCIX", ToRomanExtended(3999));
+    EXPECT_EQ("I", ToRomanExtended(1));
+}
+
+TEST(ToRomanExtended, Overlined)
+{
+    EXPECT_EQ("_I_V", ToRomanExtended(4000));
+    EXPECT_EQ("_I_VI", ToRomanExtended(4001));
+    EXPECT_EQ("_V", ToRomanExtended(5000));
+    EXPECT_EQ("_XCMXCIX", ToRomanExtended(10999));
+    EXPECT_EQ("_M", ToRomanExtended(1000000));
+    EXPECT_EQ("_M_M_M_C_M_X_C_I_XCMXCIX", ToRomanExtended(s_maxRomanExtended));
+    EXPECT_EQ(s_maxRomanExtendedLength, ToRomanExtended(3888888).size());
+}
+
+TEST(ToRomanExtended, OutOfRange)
+{
+    EXPECT_EQ("", ToRomanExtended(0));
+    EXPECT_EQ("", ToRomanExtended(s_maxRomanExtended + 1));
+}
+
+TEST(WriteRomanExtended, StreamToSink)
+{
+    std::ostringstream stream;
+    for (unsigned value : {4, 4000, 0, 5005})
+    {
+        WriteRomanExtended(value, [&stream](const char* data, size_t size) { stream.write(data, size); });
+        stream << ' ';
+    }
+    EXPECT_EQ("IV _I_V  _VV ", stream.str());
+}
+
+TEST(FromRomanExtended, Acceptance)
+{
+    EXPECT_EQ(1990u, FromRomanExtended("MCMXC"));
+    EXPECT_EQ(5000u, FromRomanExtended("_V"));
+    EXPECT_EQ(4001u, FromRomanExtended("_I_VI"));
+    EXPECT_EQ(1000000u, FromRomanExtended("_M"));
+}
+
+TEST(FromRomanExtended, Malformed)
+{
+    for (const char* numeral : {"", "_", "_V_", "_I_I_I", "_I_I_IV", "_VM", "_VMC", "_VIIII", "V_X", "_I_I_I_I_I"})
+    {
+        EXPECT_EQ(0u, FromRomanExtended(numeral)) << numeral;
+    }
+}
+
+TEST(FromRomanExtended, RoundTripAllValues)
+{
+    for (unsigned value = 1; value <= s_maxRomanExtended; ++value)
+    {
+        ASSERT_EQ(value, FromRomanExtended(ToRomanExtended(value))) << value;
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(ToRoman, DISABLED_Benchmark)
+{
+    const size_t count = 10000000;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<unsigned> value(1, s_maxRoman);
+    std::vector<unsigned> values(count);
+    for (unsigned& v : values)
+    {
+        v = value(random);
+    }
+
+    auto measure = [count](const char* name, size_t length, std::chrono::steady_clock::time_point begin)
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": " << count / seconds / 1e6 << " M numerals/s, " << length << " bytes" << std::endl;
+    };
+
+    size_t length = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned v : values)
+    {
+        length += ToRomanNaive(v).size();
+    }
+    measure("naive", length, begin);
+
+    std::vector<char> output(RomanBatchCapacity(count));
+    std::vector<size_t> offsets(count + 1);
+    begin = std::chrono::steady_clock::now();
+    length = ToRomanBatch(values.data(), count, output.data(), offsets.data());
+    measure("batch", length, begin);
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(FromRomanLines, DISABLED_Benchmark)
+{
+    const size_t count = 10000000;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<unsigned> value(1, s_maxRoman);
+    std::string text;
+    for (size_t i = 0; i < count; ++i)
+    {
+        text += ToRoman(value(random));
+        text += '\n';
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    const std::vector<unsigned> values = FromRomanLines(text);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "FromRomanLines: " << count / seconds / 1e6 << " M numerals/s, " << text.size() / seconds / (1 << 20)
+              << " MB/s, " << values.size() << " values" << std::endl;
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(ToRomanExtended, DISABLED_Benchmark)
+{
+    const size_t count = 10000000;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<unsigned> value(1, s_maxRomanExtended);
+    std::vector<unsigned> values(count);
+    for (unsigned& v : values)
+    {
+        v = value(random);
+    }
+
+    std::string text;
+    text.reserve(count * (s_maxRomanExtendedLength + 1));
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned v : values)
+    {
+        WriteRomanExtended(v, [&text](const char* data, size_t size) { text.append(data, size); });
+        text += '\n';
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "WriteRomanExtended: " << count / seconds / 1e6 << " M numerals/s, " << text.size() << " bytes" << std::endl;
+
+    size_t parsed = 0;
+    begin = std::chrono::steady_clock::now();
+    for (std::string_view rest = text; !rest.empty();)
+    {
+        const size_t lineEnd = rest.find('\n');
+        parsed += FromRomanExtended(rest.substr(0, lineEnd)) != 0;
+        rest.remove_prefix(lineEnd + 1);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "FromRomanExtended: " << count / seconds / 1e6 << " M numerals/s, " << parsed << " parsed" << std::endl;
+}
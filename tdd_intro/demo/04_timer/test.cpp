@@ -35,7 +35,24 @@ Timer can be started again any time, no metter in what state it is
 */
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 using namespace std::chrono;
 typedef high_resolution_clock Clock;
@@ -78,165 +95,2300 @@ public:
         return TimeElapsed() >= m_duration;
     }
 
+    // Reads the time once, ITime may be a real clock which is not free to call
     virtual Duration TimeLeft() const override
     {
-        if (m_started && !IsExpired())
+        if (m_started)
+        {
+            const Duration elapsed = TimeElapsed();
+            if (elapsed < m_duration)
+            {
+                return m_duration - elapsed;
+            }
+        }
+        return s_zeroDuration;
+    }
+
+private:
+    Duration TimeElapsed() const
+    {
+        if (m_started)
+        {
+            return m_time.GetCurrent() - m_startTime;
+        }
+        return s_zeroDuration;
+    }
+
+private:
+    ITime& m_time;
+    Duration m_duration;
+    bool m_started;
+    TimePoint m_startTime;
+};
+
+/*
+ * Timer queues:
+ * ITimerQueue owns many timers identified by TimerId, they behave as ITimer
+ * but expire in batches on Advance which calls back for each expired timer.
+ * Backends differ in the structure which orders deadlines, so the best one may be chosen per workload.
+*/
+
+typedef uint32_t TimerId;
+typedef std::function<void(TimerId)> ExpiredCallback;
+static const TimerId s_noTimer = std::numeric_limits<TimerId>::max();
+
+class ITimerQueue
+{
+public:
+    virtual ~ITimerQueue() { }
+
+    virtual TimerId Create(Duration duration) = 0;
+    virtual void Destroy(TimerId id) = 0;
+    // Schedules the timer from now, restarts it if it is already scheduled
+    virtual void Start(TimerId id) = 0;
+    virtual void Stop(TimerId id) = 0;
+    virtual bool IsExpired(TimerId id) const = 0;
+    virtual Duration TimeLeft(TimerId id) const = 0;
+    virtual size_t ScheduledCount() const = 0;
+    // Expired timers are unscheduled before callbacks run, so callbacks may start or stop any timer
+    virtual size_t Advance(const ExpiredCallback& onExpired) = 0;
+};
+
+/*
+ * Timer wheel:
+ * TimerWheel owns many timers and expires them in batches on Advance, time is split into ticks.
+ * Timers are kept in 4 levels of 256 slots. Level L holds timers whose deadline tick
+ * differs from the current tick starting from byte L, slot is that byte of the deadline tick.
+ * When the current tick crosses a byte boundary, slot of the upper level is cascaded to the lower ones.
+ * Deadlines further than 2^32 ticks are kept in the overflow list until the top level wraps.
+ * Every timer is a node of the doubly linked list of its slot, so Start and Stop are O(1).
+ * Advance jumps over ticks while the lower levels are empty.
+*/
+
+static const size_t s_wheelBits = 8;
+static const size_t s_wheelSlots = size_t(1) << s_wheelBits;
+static const size_t s_wheelLevels = 4;
+
+class TimerWheel: public ITimerQueue
+{
+public:
+    TimerWheel(ITime& time, Duration tick)
+        : m_time(time), m_tick(tick), m_origin(time.GetCurrent()), m_currentTick(0),
+          m_freeList(s_noTimer), m_scheduled(0)
+    {
+        std::fill(m_heads, m_heads + s_headsCount, s_noTimer);
+        std::fill(m_levelCounts, m_levelCounts + s_wheelLevels + 1, 0);
+    }
+
+    virtual TimerId Create(Duration duration) override
+    {
+        TimerId id = m_freeList;
+        if (id != s_noTimer)
+        {
+            m_freeList = m_nodes[id].next;
+        }
+        else
+        {
+            id = static_cast<TimerId>(m_nodes.size());
+            m_nodes.push_back(Node());
+        }
+        m_nodes[id] = Node();
+        m_nodes[id].duration = duration;
+        return id;
+    }
+
+    virtual void Destroy(TimerId id) override
+    {
+        Stop(id);
+        m_nodes[id].next = m_freeList;
+        m_freeList = id;
+    }
+
+    virtual void Start(TimerId id) override
+    {
+        Stop(id);
+        Node& node = m_nodes[id];
+        node.deadline = m_time.GetCurrent() + node.duration;
+        node.tick = std::max(DeadlineTick(node.deadline), m_currentTick + 1);
+        node.scheduled = true;
+        Insert(id);
+        ++m_scheduled;
+    }
+
+    virtual void Stop(TimerId id) override
+    {
+        Node& node = m_nodes[id];
+        if (node.scheduled)
+        {
+            Unlink(id);
+            node.scheduled = false;
+            --m_scheduled;
+        }
+    }
+
+    virtual bool IsExpired(TimerId id) const override
+    {
+        const Node& node = m_nodes[id];
+        return !node.scheduled || m_time.GetCurrent() >= node.deadline;
+    }
+
+    virtual Duration TimeLeft(TimerId id) const override
+    {
+        const Node& node = m_nodes[id];
+        if (node.scheduled)
+        {
+            return std::max(node.deadline - m_time.GetCurrent(), s_zeroDuration);
+        }
+        return s_zeroDuration;
+    }
+
+    virtual size_t ScheduledCount() const override
+    {
+        return m_scheduled;
+    }
+
+    // Expires timers up to the current time and calls onExpired(id) for each of them,
+    // timers of one tick are unlinked first, so callbacks may start or stop any timer
+    template <typename Func>
+    size_t Advance(Func onExpired)
+    {
+        const uint64_t target = TickOf(m_time.GetCurrent());
+        size_t expired = 0;
+        while (m_currentTick < target)
+        {
+            m_currentTick = NextTick(target);
+            Cascade();
+            expired += ExpireSlot(onExpired);
+        }
+        return expired;
+    }
+
+    virtual size_t Advance(const ExpiredCallback& onExpired) override
+    {
+        return Advance<const ExpiredCallback&>(onExpired);
+    }
+
+    size_t Advance()
+    {
+        return Advance([](TimerId) { });
+    }
+
+private:
+    struct Node
+    {
+        Node() : duration(s_zeroDuration), tick(0), prev(s_noTimer), next(s_noTimer), slot(0), scheduled(false) { }
+
+        Duration duration;
+        TimePoint deadline;
+        uint64_t tick;
+        TimerId prev;
+        TimerId next;
+        uint32_t slot;
+        bool scheduled;
+    };
+
+    static const size_t s_headsCount = s_wheelLevels * s_wheelSlots + 1;
+    static const size_t s_overflowSlot = s_wheelLevels * s_wheelSlots;
+
+    uint64_t TickOf(TimePoint point) const
+    {
+        return point > m_origin ? static_cast<uint64_t>((point - m_origin) / m_tick) : 0;
+    }
+
+    // First tick which is not earlier than the deadline, so timers never expire early
+    uint64_t DeadlineTick(TimePoint deadline) const
+    {
+        return deadline > m_origin ? static_cast<uint64_t>((deadline - m_origin + m_tick - Duration(1)) / m_tick) : 0;
+    }
+
+    void Insert(TimerId id)
+    {
+        Node& node = m_nodes[id];
+        const uint64_t difference = node.tick ^ m_currentTick;
+        size_t level = 0;
+        while (level < s_wheelLevels && (difference >> (s_wheelBits * (level + 1))) != 0)
+        {
+            ++level;
+        }
+        node.slot = static_cast<uint32_t>(level < s_wheelLevels
+            ? level * s_wheelSlots + ((node.tick >> (s_wheelBits * level)) & (s_wheelSlots - 1))
+            : s_overflowSlot);
+
+        TimerId& head = m_heads[node.slot];
+        node.prev = s_noTimer;
+        node.next = head;
+        if (head != s_noTimer)
+        {
+            m_nodes[head].prev = id;
+        }
+        head = id;
+        ++m_levelCounts[level];
+    }
+
+    void Unlink(TimerId id)
+    {
+        Node& node = m_nodes[id];
+        if (node.prev != s_noTimer)
+        {
+            m_nodes[node.prev].next = node.next;
+        }
+        else
+        {
+            m_heads[node.slot] = node.next;
+        }
+        if (node.next != s_noTimer)
+        {
+            m_nodes[node.next].prev = node.prev;
+        }
+        --m_levelCounts[node.slot / s_wheelSlots];
+    }
+
+    // Next tick where something can happen: the next one when level 0 has timers,
+    // otherwise the boundary where the lowest non-empty level is cascaded
+    uint64_t NextTick(uint64_t target) const
+    {
+        size_t level = 0;
+        while (level <= s_wheelLevels && m_levelCounts[level] == 0)
+        {
+            ++level;
+        }
+        if (level == 0)
+        {
+            return m_currentTick + 1;
+        }
+        if (level > s_wheelLevels)
+        {
+            return target;
+        }
+        const size_t shift = s_wheelBits * level;
+        return std::min(((m_currentTick >> shift) + 1) << shift, target);
+    }
+
+    // Upper levels go first, so their timers of the current tick reach level 0 now
+    void Cascade()
+    {
+        size_t top = 0;
+        while (top < s_wheelLevels && (m_currentTick & ((uint64_t(1) << (s_wheelBits * (top + 1))) - 1)) == 0)
+        {
+            ++top;
+        }
+        for (size_t level = top; level > 0; --level)
+        {
+            const size_t slot = level < s_wheelLevels
+                ? level * s_wheelSlots + ((m_currentTick >> (s_wheelBits * level)) & (s_wheelSlots - 1))
+                : s_overflowSlot;
+            TimerId id = m_heads[slot];
+            m_heads[slot] = s_noTimer;
+            while (id != s_noTimer)
+            {
+                const TimerId next = m_nodes[id].next;
+                --m_levelCounts[level];
+                Insert(id);
+                id = next;
+            }
+        }
+    }
+
+    template <typename Func>
+    size_t ExpireSlot(Func& onExpired)
+    {
+        const size_t slot = m_currentTick & (s_wheelSlots - 1);
+        m_batch.clear();
+        for (TimerId id = m_heads[slot]; id != s_noTimer; id = m_nodes[id].next)
+        {
+            m_nodes[id].scheduled = false;
+            m_batch.push_back(id);
+        }
+        m_heads[slot] = s_noTimer;
+        m_levelCounts[0] -= m_batch.size();
+        m_scheduled -= m_batch.size();
+
+        for (TimerId id : m_batch)
+        {
+            onExpired(id);
+        }
+        return m_batch.size();
+    }
+
+private:
+    ITime& m_time;
+    Duration m_tick;
+    TimePoint m_origin;
+    uint64_t m_currentTick;
+    std::vector<Node> m_nodes;
+    TimerId m_freeList;
+    TimerId m_heads[s_headsCount];
+    size_t m_levelCounts[s_wheelLevels + 1];
+    size_t m_scheduled;
+    std::vector<TimerId> m_batch;
+};
+
+// ITimer which lives in the timer queue
+class QueueTimer: public ITimer
+{
+public:
+    QueueTimer(ITimerQueue& queue, Duration duration)
+        : m_queue(queue), m_id(queue.Create(duration))
+    { }
+
+    ~QueueTimer()
+    {
+        m_queue.Destroy(m_id);
+    }
+
+    QueueTimer(const QueueTimer&) = delete;
+    QueueTimer& operator=(const QueueTimer&) = delete;
+
+    virtual void Start() override
+    {
+        m_queue.Start(m_id);
+    }
+
+    virtual bool IsExpired() const override
+    {
+        return m_queue.IsExpired(m_id);
+    }
+
+    virtual Duration TimeLeft() const override
+    {
+        return m_queue.TimeLeft(m_id);
+    }
+
+    void Stop()
+    {
+        m_queue.Stop(m_id);
+    }
+
+    TimerId Id() const
+    {
+        return m_id;
+    }
+
+private:
+    ITimerQueue& m_queue;
+    TimerId m_id;
+};
+
+/*
+ * Heap timer queues:
+ * TimerQueueBase keeps durations and deadlines of timers, backends only order scheduled timers.
+ * HeapTimerQueue is an implicit heap with the given arity, entries keep deadlines next to ids
+ * and every timer knows its position, so Stop and restart sift one entry. 4-ary heap is shallower
+ * and its children share cache lines, so it does fewer cache misses than the binary one.
+ * PairingHeapTimerQueue links timers into a pairing heap, Start is O(1) and the work is
+ * postponed to pops, which suits timers that are mostly stopped before they expire.
+*/
+
+class TimerQueueBase: public ITimerQueue
+{
+public:
+    virtual TimerId Create(Duration duration) override
+    {
+        TimerId id = m_freeList;
+        if (id != s_noTimer)
+        {
+            m_freeList = m_timers[id].nextFree;
+        }
+        else
+        {
+            id = static_cast<TimerId>(m_timers.size());
+            m_timers.push_back(TimerState());
+        }
+        m_timers[id] = TimerState();
+        m_timers[id].duration = duration;
+        return id;
+    }
+
+    virtual void Destroy(TimerId id) override
+    {
+        Stop(id);
+        m_timers[id].nextFree = m_freeList;
+        m_freeList = id;
+    }
+
+    virtual bool IsExpired(TimerId id) const override
+    {
+        const TimerState& timer = m_timers[id];
+        return !timer.scheduled || m_time.GetCurrent() >= timer.deadline;
+    }
+
+    virtual Duration TimeLeft(TimerId id) const override
+    {
+        const TimerState& timer = m_timers[id];
+        if (timer.scheduled)
+        {
+            return std::max(timer.deadline - m_time.GetCurrent(), s_zeroDuration);
+        }
+        return s_zeroDuration;
+    }
+
+    virtual size_t ScheduledCount() const override
+    {
+        return m_scheduled;
+    }
+
+protected:
+    explicit TimerQueueBase(ITime& time)
+        : m_time(time), m_freeList(s_noTimer), m_scheduled(0)
+    { }
+
+    struct TimerState
+    {
+        TimerState() : duration(s_zeroDuration), scheduled(false), nextFree(s_noTimer) { }
+
+        Duration duration;
+        TimePoint deadline;
+        bool scheduled;
+        TimerId nextFree;
+    };
+
+    size_t RunCallbacks(const ExpiredCallback& onExpired)
+    {
+        for (TimerId id : m_batch)
+        {
+            onExpired(id);
+        }
+        return m_batch.size();
+    }
+
+protected:
+    ITime& m_time;
+    std::vector<TimerState> m_timers;
+    TimerId m_freeList;
+    size_t m_scheduled;
+    std::vector<TimerId> m_batch;
+};
+
+template <size_t Arity>
+class HeapTimerQueue: public TimerQueueBase
+{
+public:
+    explicit HeapTimerQueue(ITime& time)
+        : TimerQueueBase(time)
+    { }
+
+    virtual TimerId Create(Duration duration) override
+    {
+        const TimerId id = TimerQueueBase::Create(duration);
+        if (id >= m_positions.size())
+        {
+            m_positions.resize(id + 1);
+        }
+        return id;
+    }
+
+    virtual void Start(TimerId id) override
+    {
+        TimerState& timer = m_timers[id];
+        timer.deadline = m_time.GetCurrent() + timer.duration;
+        if (timer.scheduled)
+        {
+            const size_t position = m_positions[id];
+            m_heap[position].deadline = timer.deadline;
+            SiftDown(SiftUp(position));
+            return;
+        }
+        timer.scheduled = true;
+        ++m_scheduled;
+        m_heap.push_back(Entry{timer.deadline, id});
+        m_positions[id] = m_heap.size() - 1;
+        SiftUp(m_heap.size() - 1);
+    }
+
+    virtual void Stop(TimerId id) override
+    {
+        TimerState& timer = m_timers[id];
+        if (timer.scheduled)
+        {
+            timer.scheduled = false;
+            --m_scheduled;
+            Remove(m_positions[id]);
+        }
+    }
+
+    virtual size_t Advance(const ExpiredCallback& onExpired) override
+    {
+        const TimePoint now = m_time.GetCurrent();
+        m_batch.clear();
+        while (!m_heap.empty() && m_heap.front().deadline <= now)
+        {
+            const TimerId id = m_heap.front().id;
+            m_timers[id].scheduled = false;
+            --m_scheduled;
+            m_batch.push_back(id);
+            Remove(0);
+        }
+        return RunCallbacks(onExpired);
+    }
+
+private:
+    struct Entry
+    {
+        TimePoint deadline;
+        TimerId id;
+    };
+
+    void Remove(size_t position)
+    {
+        const size_t last = m_heap.size() - 1;
+        if (position != last)
+        {
+            Place(position, m_heap[last]);
+            m_heap.pop_back();
+            SiftDown(SiftUp(position));
+        }
+        else
+        {
+            m_heap.pop_back();
+        }
+    }
+
+    void Place(size_t position, const Entry& entry)
+    {
+        m_heap[position] = entry;
+        m_positions[entry.id] = position;
+    }
+
+    size_t SiftUp(size_t position)
+    {
+        const Entry entry = m_heap[position];
+        while (position > 0)
+        {
+            const size_t parent = (position - 1) / Arity;
+            if (m_heap[parent].deadline <= entry.deadline)
+            {
+                break;
+            }
+            Place(position, m_heap[parent]);
+            position = parent;
+        }
+        Place(position, entry);
+        return position;
+    }
+
+    void SiftDown(size_t position)
+    {
+        const Entry entry = m_heap[position];
+        const size_t size = m_heap.size();
+        while (true)
+        {
+            const size_t first = position * Arity + 1;
+            if (first >= size)
+            {
+                break;
+            }
+            size_t smallest = first;
+            const size_t end = std::min(first + Arity, size);
+            for (size_t child = first + 1; child < end; ++child)
+            {
+                if (m_heap[child].deadline < m_heap[smallest].deadline)
+                {
+                    smallest = child;
+                }
+            }
+            if (entry.deadline <= m_heap[smallest].deadline)
+            {
+                break;
+            }
+            Place(position, m_heap[smallest]);
+            position = smallest;
+        }
+        Place(position, entry);
+    }
+
+private:
+    std::vector<Entry> m_heap;
+    std::vector<size_t> m_positions;
+};
+
+typedef HeapTimerQueue<2> BinaryHeapTimerQueue;
+typedef HeapTimerQueue<4> QuaternaryHeapTimerQueue;
+
+class PairingHeapTimerQueue: public TimerQueueBase
+{
+public:
+    explicit PairingHeapTimerQueue(ITime& time)
+        : TimerQueueBase(time), m_root(s_noTimer)
+    { }
+
+    virtual TimerId Create(Duration duration) override
+    {
+        const TimerId id = TimerQueueBase::Create(duration);
+        if (id >= m_links.size())
+        {
+            m_links.resize(id + 1);
+        }
+        return id;
+    }
+
+    virtual void Start(TimerId id) override
+    {
+        Stop(id);
+        TimerState& timer = m_timers[id];
+        timer.deadline = m_time.GetCurrent() + timer.duration;
+        timer.scheduled = true;
+        ++m_scheduled;
+        m_links[id] = Links();
+        m_root = Meld(m_root, id);
+    }
+
+    virtual void Stop(TimerId id) override
+    {
+        TimerState& timer = m_timers[id];
+        if (!timer.scheduled)
+        {
+            return;
+        }
+        timer.scheduled = false;
+        --m_scheduled;
+        if (id == m_root)
+        {
+            m_root = MergePairs(m_links[id].child);
+            return;
+        }
+
+        // Cut the subtree out of its parent, its children become a heap of their own
+        Links& links = m_links[id];
+        if (m_links[links.prev].child == id)
+        {
+            m_links[links.prev].child = links.sibling;
+        }
+        else
+        {
+            m_links[links.prev].sibling = links.sibling;
+        }
+        if (links.sibling != s_noTimer)
+        {
+            m_links[links.sibling].prev = links.prev;
+        }
+        m_root = Meld(m_root, MergePairs(links.child));
+    }
+
+    virtual size_t Advance(const ExpiredCallback& onExpired) override
+    {
+        const TimePoint now = m_time.GetCurrent();
+        m_batch.clear();
+        while (m_root != s_noTimer && m_timers[m_root].deadline <= now)
+        {
+            const TimerId id = m_root;
+            m_timers[id].scheduled = false;
+            --m_scheduled;
+            m_batch.push_back(id);
+            m_root = MergePairs(m_links[id].child);
+        }
+        return RunCallbacks(onExpired);
+    }
+
+private:
+    // prev is the parent for the first child and the left sibling for others
+    struct Links
+    {
+        Links() : child(s_noTimer), sibling(s_noTimer), prev(s_noTimer) { }
+
+        TimerId child;
+        TimerId sibling;
+        TimerId prev;
+    };
+
+    // Both are roots without siblings, the later deadline becomes the first child
+    TimerId Meld(TimerId first, TimerId second)
+    {
+        if (first == s_noTimer)
+        {
+            return second;
+        }
+        if (second == s_noTimer)
+        {
+            return first;
+        }
+        if (m_timers[second].deadline < m_timers[first].deadline)
+        {
+            std::swap(first, second);
+        }
+        Links& parent = m_links[first];
+        Links& child = m_links[second];
+        child.sibling = parent.child;
+        if (parent.child != s_noTimer)
+        {
+            m_links[parent.child].prev = second;
+        }
+        child.prev = first;
+        parent.child = second;
+        return first;
+    }
+
+    TimerId Detach(TimerId id)
+    {
+        m_links[id].sibling = s_noTimer;
+        m_links[id].prev = s_noTimer;
+        return id;
+    }
+
+    // Two pass merge: siblings are melded in pairs from the left, then pairs are melded from the right
+    TimerId MergePairs(TimerId first)
+    {
+        if (first == s_noTimer)
+        {
+            return s_noTimer;
+        }
+        m_pairs.clear();
+        while (first != s_noTimer)
+        {
+            const TimerId second = m_links[first].sibling;
+            if (second == s_noTimer)
+            {
+                m_pairs.push_back(Detach(first));
+                break;
+            }
+            const TimerId next = m_links[second].sibling;
+            m_pairs.push_back(Meld(Detach(first), Detach(second)));
+            first = next;
+        }
+        TimerId root = m_pairs.back();
+        for (size_t i = m_pairs.size() - 1; i > 0; --i)
+        {
+            root = Meld(m_pairs[i - 1], root);
+        }
+        return root;
+    }
+
+private:
+    std::vector<Links> m_links;
+    TimerId m_root;
+    std::vector<TimerId> m_pairs;
+};
+
+/*
+ * Clock sources:
+ * SystemTime reads Clock on every call.
+ * CoarseTime keeps the current time in an atomic refreshed by a ticker thread with the given resolution,
+ * so reading is a relaxed load which costs as much as reading a plain variable. The time is taken
+ * from SystemTime or from the given source, without resolution there is no ticker and Update refreshes it.
+ * MonotonicCoarseTime reads CLOCK_MONOTONIC_COARSE which the kernel updates every scheduler tick
+ * and serves without a system call. Its epoch differs from Clock, so time points of one source
+ * should not be mixed with another, Timer only subtracts points of its own ITime.
+*/
+
+class SystemTime: public ITime
+{
+public:
+    virtual TimePoint GetCurrent() override
+    {
+        return Clock::now();
+    }
+};
+
+class CoarseTime: public ITime
+{
+public:
+    explicit CoarseTime(Duration resolution)
+        : CoarseTime(SystemSource(), resolution)
+    { }
+
+    // Zero resolution starts no ticker thread
+    CoarseTime(ITime& source, Duration resolution)
+        : m_source(source), m_resolution(resolution), m_current(source.GetCurrent().time_since_epoch().count()),
+          m_stopped(false)
+    {
+        if (resolution > s_zeroDuration)
+        {
+            m_ticker = std::thread(&CoarseTime::Tick, this);
+        }
+    }
+
+    ~CoarseTime()
+    {
+        if (m_ticker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopped = true;
+            }
+            m_wakeUp.notify_one();
+            m_ticker.join();
+        }
+    }
+
+    CoarseTime(const CoarseTime&) = delete;
+    CoarseTime& operator=(const CoarseTime&) = delete;
+
+    virtual TimePoint GetCurrent() override
+    {
+        return TimePoint(Duration(m_current.load(std::memory_order_relaxed)));
+    }
+
+    // Takes the current time of the source, the ticker thread calls it every resolution
+    void Update()
+    {
+        m_current.store(m_source.GetCurrent().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+private:
+    static ITime& SystemSource()
+    {
+        static SystemTime s_systemTime;
+        return s_systemTime;
+    }
+
+    void Tick()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_wakeUp.wait_for(lock, m_resolution, [this]() { return m_stopped; }))
+        {
+            Update();
+        }
+    }
+
+private:
+    ITime& m_source;
+    Duration m_resolution;
+    std::atomic<Clock::rep> m_current;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopped;
+    std::thread m_ticker;
+};
+
+#ifdef CLOCK_MONOTONIC_COARSE
+class MonotonicCoarseTime: public ITime
+{
+public:
+    virtual TimePoint GetCurrent() override
+    {
+        timespec current;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &current);
+        return TimePoint(duration_cast<Duration>(seconds(current.tv_sec) + nanoseconds(current.tv_nsec)));
+    }
+};
+#endif
+
+/*
+ * Timer service:
+ * TimerService runs callbacks when their delays expire.
+ * Schedule and Cancel may be called from any thread, they push commands into a lock-free
+ * multiple producers single consumer stack, the consumer takes the whole stack at once
+ * and reverses it to restore the order of commands. Producers allocate every command with new,
+ * so only the stack itself is lock-free, not the allocation.
+ * Dispatch is the consumer: it moves commands into an ordered set of deadlines and runs expired callbacks
+ * in one batch. Cancel commands erase both the callback and its deadline when they are drained.
+ * Tests call Dispatch directly with FakeTime. StartDispatcher runs it on a thread which sleeps
+ * until the nearest deadline, producers wake it only when they push into the empty stack.
+*/
+
+typedef uint64_t CallbackId;
+typedef std::function<void()> Callback;
+
+class CommandStack
+{
+public:
+    struct Command
+    {
+        CallbackId id;
+        TimePoint deadline;
+        Callback callback;
+        bool cancel;
+        Command* next;
+    };
+
+    CommandStack() : m_head(nullptr) { }
+
+    ~CommandStack()
+    {
+        Delete(PopAll());
+    }
+
+    CommandStack(const CommandStack&) = delete;
+    CommandStack& operator=(const CommandStack&) = delete;
+
+    // Returns true if the stack was empty
+    bool Push(Command* command)
+    {
+        Command* head = m_head.load(std::memory_order_relaxed);
+        do
+        {
+            command->next = head;
+        }
+        while (!m_head.compare_exchange_weak(head, command, std::memory_order_release, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Commands in the order they were pushed
+    Command* PopAll()
+    {
+        Command* head = m_head.exchange(nullptr, std::memory_order_acquire);
+        Command* reversed = nullptr;
+        while (head != nullptr)
+        {
+            Command* next = head->next;
+            head->next = reversed;
+            reversed = head;
+            head = next;
+        }
+        return reversed;
+    }
+
+    bool IsEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == nullptr;
+    }
+
+    static void Delete(Command* command)
+    {
+        while (command != nullptr)
+        {
+            Command* next = command->next;
+            delete command;
+            command = next;
+        }
+    }
+
+private:
+    std::atomic<Command*> m_head;
+};
+
+class TimerService
+{
+public:
+    explicit TimerService(ITime& time)
+        : m_time(time), m_nextId(1), m_stopped(false)
+    { }
+
+    ~TimerService()
+    {
+        StopDispatcher();
+    }
+
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    CallbackId Schedule(Duration delay, Callback callback)
+    {
+        const CallbackId id = m_nextId.fetch_add(1, std::memory_order_relaxed);
+        Push(new CommandStack::Command{id, m_time.GetCurrent() + delay, std::move(callback), false, nullptr});
+        return id;
+    }
+
+    // Callback will not run if it is cancelled before it expires
+    void Cancel(CallbackId id)
+    {
+        Push(new CommandStack::Command{id, TimePoint(), Callback(), true, nullptr});
+    }
+
+    // Runs expired callbacks on the calling thread, only one thread may dispatch
+    size_t Dispatch()
+    {
+        CommandStack::Command* commands = m_commands.PopAll();
+        for (CommandStack::Command* command = commands; command != nullptr; command = command->next)
+        {
+            if (command->cancel)
+            {
+                auto found = m_callbacks.find(command->id);
+                if (found != m_callbacks.end())
+                {
+                    m_deadlines.erase(Deadline{found->second.deadline, command->id});
+                    m_callbacks.erase(found);
+                }
+            }
+            else
+            {
+                m_callbacks.emplace(command->id, Entry{command->deadline, std::move(command->callback)});
+                m_deadlines.insert(Deadline{command->deadline, command->id});
+            }
+        }
+        CommandStack::Delete(commands);
+
+        const TimePoint now = m_time.GetCurrent();
+        m_batch.clear();
+        while (!m_deadlines.empty() && m_deadlines.begin()->point <= now)
+        {
+            auto found = m_callbacks.find(m_deadlines.begin()->id);
+            m_batch.push_back(std::move(found->second.callback));
+            m_callbacks.erase(found);
+            m_deadlines.erase(m_deadlines.begin());
+        }
+
+        for (Callback& callback : m_batch)
+        {
+            callback();
+        }
+        return m_batch.size();
+    }
+
+    // Nearest deadline of not cancelled callbacks known to the dispatcher
+    bool NextDeadline(TimePoint& deadline) const
+    {
+        if (m_deadlines.empty())
+        {
+            return false;
+        }
+        deadline = m_deadlines.begin()->point;
+        return true;
+    }
+
+    void StartDispatcher()
+    {
+        m_stopped = false;
+        m_dispatcher = std::thread(&TimerService::RunDispatcher, this);
+    }
+
+    void StopDispatcher()
+    {
+        if (m_dispatcher.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopped = true;
+            }
+            m_wakeUp.notify_one();
+            m_dispatcher.join();
+        }
+    }
+
+private:
+    struct Deadline
+    {
+        TimePoint point;
+        CallbackId id;
+
+        bool operator<(const Deadline& other) const
+        {
+            return point != other.point ? point < other.point : id < other.id;
+        }
+    };
+
+    struct Entry
+    {
+        TimePoint deadline;
+        Callback callback;
+    };
+
+    // Dispatcher checks the stack under the mutex before sleeping, so the wake up is not lost
+    void Push(CommandStack::Command* command)
+    {
+        if (m_commands.Push(command))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_wakeUp.notify_one();
+        }
+    }
+
+    void RunDispatcher()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopped)
+        {
+            lock.unlock();
+            Dispatch();
+            lock.lock();
+
+            auto ready = [this]() { return m_stopped || !m_commands.IsEmpty(); };
+            TimePoint deadline;
+            if (NextDeadline(deadline))
+            {
+                m_wakeUp.wait_for(lock, deadline - m_time.GetCurrent(), ready);
+            }
+            else
+            {
+                m_wakeUp.wait(lock, ready);
+            }
+        }
+    }
+
+private:
+    ITime& m_time;
+    std::atomic<CallbackId> m_nextId;
+    CommandStack m_commands;
+    std::set<Deadline> m_deadlines;
+    std::unordered_map<CallbackId, Entry> m_callbacks;
+    std::vector<Callback> m_batch;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopped;
+    std::thread m_dispatcher;
+};
+
+/*
+ * Periodic timer and rate limiter:
+ * PeriodicTimer moves its deadline by whole periods from the previous deadline, not from now,
+ * so late polling does not shift later deadlines. Consume claims all periods which
+ * expired with one compare and swap of the deadline, so every period is claimed by one caller only.
+ * TokenBucket keeps one atomic time point instead of the tokens count: the time when the bucket
+ * would be full again. Every token moves it one interval later, request is refused
+ * if the point would be further from now than the whole bucket, TryAcquire is a compare and swap loop.
+*/
+
+class PeriodicTimer: public ITimer
+{
+public:
+    // Throws std::invalid_argument if the period is not positive
+    PeriodicTimer(ITime& time, Duration period)
+        : m_time(time), m_period(period), m_deadline(s_notStarted)
+    {
+        if (period <= s_zeroDuration)
+        {
+            throw std::invalid_argument("Period of a periodic timer must be positive");
+        }
+    }
+
+    virtual void Start() override
+    {
+        m_deadline.store((m_time.GetCurrent() + m_period).time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    virtual bool IsExpired() const override
+    {
+        const Clock::rep deadline = m_deadline.load(std::memory_order_relaxed);
+        return deadline == s_notStarted || m_time.GetCurrent().time_since_epoch().count() >= deadline;
+    }
+
+    virtual Duration TimeLeft() const override
+    {
+        const Clock::rep deadline = m_deadline.load(std::memory_order_relaxed);
+        if (deadline == s_notStarted)
+        {
+            return s_zeroDuration;
+        }
+        return std::max(Duration(deadline) - m_time.GetCurrent().time_since_epoch(), s_zeroDuration);
+    }
+
+    // Number of periods which expired since the last call, the deadline moves past now
+    size_t Consume()
+    {
+        const Clock::rep now = m_time.GetCurrent().time_since_epoch().count();
+        Clock::rep deadline = m_deadline.load(std::memory_order_relaxed);
+        Clock::rep next;
+        size_t periods;
+        do
+        {
+            if (deadline == s_notStarted || now < deadline)
+            {
+                return 0;
+            }
+            periods = static_cast<size_t>((now - deadline) / m_period.count()) + 1;
+            next = deadline + static_cast<Clock::rep>(periods) * m_period.count();
+        }
+        while (!m_deadline.compare_exchange_weak(deadline, next, std::memory_order_relaxed));
+        return periods;
+    }
+
+private:
+    static const Clock::rep s_notStarted = std::numeric_limits<Clock::rep>::min();
+
+private:
+    ITime& m_time;
+    Duration m_period;
+    std::atomic<Clock::rep> m_deadline;
+};
+
+class TokenBucket
+{
+public:
+    // Bucket starts full and gets one token every interval. Throws std::invalid_argument if the interval is not positive.
+    TokenBucket(ITime& time, Duration interval, size_t capacity)
+        : m_time(time), m_interval(interval.count()), m_capacity(static_cast<Clock::rep>(capacity) * interval.count()),
+          m_fullAt(time.GetCurrent().time_since_epoch().count())
+    {
+        if (interval <= s_zeroDuration)
+        {
+            throw std::invalid_argument("Refill interval of a token bucket must be positive");
+        }
+    }
+
+    bool TryAcquire(size_t tokens = 1)
+    {
+        const Clock::rep now = m_time.GetCurrent().time_since_epoch().count();
+        const Clock::rep cost = static_cast<Clock::rep>(tokens) * m_interval;
+        Clock::rep fullAt = m_fullAt.load(std::memory_order_relaxed);
+        Clock::rep next;
+        do
+        {
+            next = std::max(fullAt, now) + cost;
+            if (next - now > m_capacity)
+            {
+                return false;
+            }
+        }
+        while (!m_fullAt.compare_exchange_weak(fullAt, next, std::memory_order_relaxed));
+        return true;
+    }
+
+    size_t Available() const
+    {
+        const Clock::rep now = m_time.GetCurrent().time_since_epoch().count();
+        const Clock::rep used = std::max(m_fullAt.load(std::memory_order_relaxed) - now, Clock::rep(0));
+        return static_cast<size_t>((m_capacity - used) / m_interval);
+    }
+
+private:
+    ITime& m_time;
+    Clock::rep m_interval;
+    Clock::rep m_capacity;
+    std::atomic<Clock::rep> m_fullAt;
+};
+
+class FakeTime: public ITime
+{
+public:
+    virtual TimePoint GetCurrent() { return m_current; }
+
+    void Wait(Duration duration) { m_current += duration; }
+
+private:
+    TimePoint m_current;
+};
+
+TEST(Timer, StartNoCheck)
+{
+    FakeTime time;
+    Timer timer(time, s_zeroDuration);
+    timer.Start();
+}
+
+TEST(Timer, IsExpired_NotStarted)
+{
+    FakeTime time;
+    Timer timer(time, s_zeroDuration);
+    ASSERT_TRUE(timer.IsExpired());
+}
+
+TEST(Timer, IsExpired_0AndStarted)
+{
+    FakeTime time;
+    Timer timer(time, s_zeroDuration);
+    timer.Start();
+    ASSERT_TRUE(timer.IsExpired());
+}
+
+TEST(Timer, IsExpired_Not0AndStarted)
+{
+    FakeTime time;
+    Timer timer(time, seconds(1));
+    timer.Start();
+    ASSERT_FALSE(timer.IsExpired());
+}
+
+TEST(Timer, TimeLeft_NotStarted)
+{
+    FakeTime time;
+    Timer timer(time, seconds(1));
+    ASSERT_EQ(seconds(0), timer.TimeLeft());
+}
+
+TEST(Timer, TimeLeft_Started)
+{
+    FakeTime time;
+    Timer timer(time, seconds(1));
+    timer.Start();
+    ASSERT_EQ(seconds(1), timer.TimeLeft());
+}
+
+TEST(Timer, TimeLeft_Started2)
+{
+    FakeTime time;
+    Timer timer(time, seconds(2));
+    timer.Start();
+    ASSERT_EQ(seconds(2), timer.TimeLeft());
+}
+
+TEST(Timer, TimeLeft_Started_AfterWaiting)
+{
+    FakeTime time;
+    Timer timer(time, seconds(2));
+    timer.Start();
+    time.Wait(seconds(1));
+    ASSERT_EQ(seconds(1), timer.TimeLeft());
+}
+
+TEST(Timer, TimeLeft_Started_AfterWaiting2)
+{
+    FakeTime time;
+    Timer timer(time, seconds(10));
+    timer.Start();
+    time.Wait(seconds(3));
+    ASSERT_EQ(seconds(7), timer.TimeLeft());
+}
+
+TEST(Timer, TimeLeft_Wait_Started_AfterWaiting)
+{
+    FakeTime time;
+    time.Wait(seconds(5));
+    Timer timer(time, seconds(10));
+    timer.Start();
+    time.Wait(seconds(3));
+    ASSERT_EQ(seconds(7), timer.TimeLeft());
+}
+
+TEST(Timer, TimeLeft_Expired)
+{
+    FakeTime time;
+    time.Wait(seconds(2));
+    Timer timer(time, seconds(4));
+    timer.Start();
+    time.Wait(seconds(6));
+    ASSERT_EQ(seconds(0), timer.TimeLeft());
+}
+
+TEST(Timer, IsExpired_NoTimeLeft)
+{
+    FakeTime time;
+    time.Wait(seconds(2));
+    Timer timer(time, seconds(3));
+    timer.Start();
+    time.Wait(seconds(6));
+    ASSERT_TRUE(timer.IsExpired());
+}
+
+TEST(Timer, IsExpired_TimeIsLeft)
+{
+    FakeTime time;
+    time.Wait(seconds(2));
+    Timer timer(time, seconds(5));
+    timer.Start();
+    time.Wait(seconds(2));
+    ASSERT_FALSE(timer.IsExpired());
+}
+
+TEST(Timer, IsExpired_TimeLeaft_AfterTimerRestart)
+{
+    FakeTime time;
+    time.Wait(seconds(1));
+    Timer timer(time, seconds(5));
+    timer.Start();
+    time.Wait(seconds(2));
+    ASSERT_EQ(seconds(3), timer.TimeLeft());
+
+    // Restarting the timer
+    timer.Start();
+    ASSERT_EQ(seconds(5), timer.TimeLeft());
+}
+
+class CountingTime: public FakeTime
+{
+public:
+    CountingTime() : m_reads(0) { }
+
+    virtual TimePoint GetCurrent() override
+    {
+        ++m_reads;
+        return FakeTime::GetCurrent();
+    }
+
+    size_t Reads() const { return m_reads; }
+
+private:
+    size_t m_reads;
+};
+
+TEST(Timer, TimeLeft_ReadsTimeOnce)
+{
+    CountingTime time;
+    Timer timer(time, seconds(5));
+    timer.Start();
+    time.Wait(seconds(2));
+    const size_t reads = time.Reads();
+    ASSERT_EQ(seconds(3), timer.TimeLeft());
+    ASSERT_EQ(reads + 1, time.Reads());
+    ASSERT_FALSE(timer.IsExpired());
+    ASSERT_EQ(reads + 2, time.Reads());
+}
+
+TEST(CoarseTime, FollowsSourceOnUpdate)
+{
+    FakeTime source;
+    source.Wait(seconds(10));
+    CoarseTime time(source, s_zeroDuration);
+    ASSERT_EQ(source.GetCurrent(), time.GetCurrent());
+    source.Wait(milliseconds(5));
+    ASSERT_EQ(source.GetCurrent() - milliseconds(5), time.GetCurrent());
+    time.Update();
+    ASSERT_EQ(source.GetCurrent(), time.GetCurrent());
+}
+
+TEST(CoarseTime, DrivesTimer)
+{
+    FakeTime source;
+    CoarseTime time(source, s_zeroDuration);
+    Timer timer(time, milliseconds(20));
+    timer.Start();
+    source.Wait(milliseconds(30));
+    ASSERT_FALSE(timer.IsExpired());
+    ASSERT_EQ(milliseconds(20), timer.TimeLeft());
+    time.Update();
+    ASSERT_TRUE(timer.IsExpired());
+    ASSERT_EQ(s_zeroDuration, timer.TimeLeft());
+}
+
+TEST(CoarseTime, TickerEventuallyAdvances)
+{
+    CoarseTime time(milliseconds(1));
+    const TimePoint begin = time.GetCurrent();
+    const Clock::time_point giveUp = Clock::now() + seconds(10);
+    while (time.GetCurrent() == begin && Clock::now() < giveUp)
+    {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    ASSERT_LT(begin, time.GetCurrent());
+}
+
+#ifdef CLOCK_MONOTONIC_COARSE
+TEST(MonotonicCoarseTime, IsMonotonic)
+{
+    MonotonicCoarseTime time;
+    TimePoint previous = time.GetCurrent();
+    for (int i = 0; i < 100000; ++i)
+    {
+        const TimePoint current = time.GetCurrent();
+        ASSERT_LE(previous, current);
+        previous = current;
+    }
+}
+#endif
+
+// Run with --gtest_also_run_disabled_tests
+TEST(ClockSources, DISABLED_Benchmark)
+{
+    const size_t callsCount = 50000000;
+    auto measure = [callsCount](const char* name, ITime& time)
+    {
+        Timer timer(time, hours(1));
+        timer.Start();
+        Clock::rep checksum = 0;
+        Clock::time_point begin = Clock::now();
+        for (size_t i = 0; i < callsCount; ++i)
+        {
+            checksum += time.GetCurrent().time_since_epoch().count() & 1;
+        }
+        const double readSeconds = duration<double>(Clock::now() - begin).count();
+        begin = Clock::now();
+        for (size_t i = 0; i < callsCount; ++i)
+        {
+            checksum += timer.TimeLeft().count() & 1;
+        }
+        const double timeLeftSeconds = duration<double>(Clock::now() - begin).count();
+        std::cout << name << ": " << readSeconds * 1e9 / callsCount << " ns per GetCurrent, "
+                  << timeLeftSeconds * 1e9 / callsCount << " ns per TimeLeft, checksum " << checksum << std::endl;
+    };
+
+    SystemTime system;
+    measure("high_resolution_clock", system);
+    CoarseTime coarse(milliseconds(1));
+    measure("ticker thread, 1 ms", coarse);
+#ifdef CLOCK_MONOTONIC_COARSE
+    MonotonicCoarseTime monotonicCoarse;
+    measure("CLOCK_MONOTONIC_COARSE", monotonicCoarse);
+#endif
+}
+
+TEST(TimerWheel, QueueTimerBehavesAsTimer)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    QueueTimer timer(wheel, seconds(5));
+    ASSERT_TRUE(timer.IsExpired());
+    ASSERT_EQ(s_zeroDuration, timer.TimeLeft());
+
+    timer.Start();
+    time.Wait(seconds(2));
+    ASSERT_FALSE(timer.IsExpired());
+    ASSERT_EQ(seconds(3), timer.TimeLeft());
+
+    timer.Start();
+    ASSERT_EQ(seconds(5), timer.TimeLeft());
+    time.Wait(seconds(5));
+    ASSERT_TRUE(timer.IsExpired());
+    ASSERT_EQ(s_zeroDuration, timer.TimeLeft());
+}
+
+TEST(TimerWheel, ExpiresInBatchesPerTick)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    const TimerId first = wheel.Create(milliseconds(10));
+    const TimerId second = wheel.Create(milliseconds(10));
+    const TimerId third = wheel.Create(milliseconds(20));
+    wheel.Start(first);
+    wheel.Start(second);
+    wheel.Start(third);
+
+    std::vector<TimerId> expired;
+    auto collect = [&expired](TimerId id) { expired.push_back(id); };
+    time.Wait(milliseconds(9));
+    ASSERT_EQ(0u, wheel.Advance(collect));
+    time.Wait(milliseconds(1));
+    ASSERT_EQ(2u, wheel.Advance(collect));
+    std::sort(expired.begin(), expired.end());
+    ASSERT_EQ(std::vector<TimerId>({first, second}), expired);
+    ASSERT_EQ(1u, wheel.ScheduledCount());
+
+    time.Wait(milliseconds(100));
+    ASSERT_EQ(1u, wheel.Advance(collect));
+    ASSERT_EQ(third, expired.back());
+    ASSERT_EQ(0u, wheel.ScheduledCount());
+}
+
+TEST(TimerWheel, NeverExpiresEarly)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    wheel.Start(wheel.Create(microseconds(1500)));
+    time.Wait(milliseconds(1));
+    ASSERT_EQ(0u, wheel.Advance());
+    time.Wait(microseconds(400));
+    ASSERT_EQ(0u, wheel.Advance());
+    time.Wait(microseconds(600));
+    ASSERT_EQ(1u, wheel.Advance());
+}
+
+TEST(TimerWheel, StopCancelsExpiry)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    const TimerId id = wheel.Create(milliseconds(300));
+    wheel.Start(id);
+    wheel.Stop(id);
+    wheel.Stop(id);
+    time.Wait(seconds(1));
+    ASSERT_EQ(0u, wheel.Advance());
+    ASSERT_TRUE(wheel.IsExpired(id));
+}
+
+TEST(TimerWheel, RestartMovesDeadline)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    const TimerId id = wheel.Create(milliseconds(300));
+    wheel.Start(id);
+    time.Wait(milliseconds(200));
+    ASSERT_EQ(0u, wheel.Advance());
+    wheel.Start(id);
+    time.Wait(milliseconds(299));
+    ASSERT_EQ(0u, wheel.Advance());
+    time.Wait(milliseconds(1));
+    ASSERT_EQ(1u, wheel.Advance());
+}
+
+TEST(TimerWheel, CascadesFromUpperLevels)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    const std::vector<Duration> durations = {milliseconds(255), milliseconds(256), milliseconds(257),
+                                             milliseconds(65536), seconds(70), hours(5), hours(24 * 50)};
+    for (Duration duration : durations)
+    {
+        wheel.Start(wheel.Create(duration));
+    }
+    for (Duration duration : durations)
+    {
+        time.Wait(duration - milliseconds(1) - (time.GetCurrent() - TimePoint()));
+        ASSERT_EQ(0u, wheel.Advance()) << duration.count();
+        time.Wait(milliseconds(1));
+        ASSERT_EQ(1u, wheel.Advance()) << duration.count();
+    }
+    ASSERT_EQ(0u, wheel.ScheduledCount());
+}
+
+TEST(TimerWheel, RestartFromCallback)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    const TimerId id = wheel.Create(milliseconds(10));
+    wheel.Start(id);
+    size_t fired = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        time.Wait(milliseconds(1));
+        wheel.Advance([&](TimerId expired) { ++fired; wheel.Start(expired); });
+    }
+    ASSERT_EQ(10u, fired);
+}
+
+TEST(TimerWheel, ReusesDestroyedTimers)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    const TimerId id = wheel.Create(milliseconds(10));
+    wheel.Start(id);
+    wheel.Destroy(id);
+    ASSERT_EQ(0u, wheel.ScheduledCount());
+    ASSERT_EQ(id, wheel.Create(milliseconds(20)));
+}
+
+// Random starts and stops with expiries compared to deadlines floored to the queue resolution
+void CheckAgainstBruteForce(ITimerQueue& queue, FakeTime& time, Duration resolution)
+{
+    std::mt19937 random(42);
+    const size_t timersCount = 1000;
+    std::vector<bool> scheduled(timersCount, false);
+    std::vector<TimePoint> deadlines(timersCount);
+    for (size_t i = 0; i < timersCount; ++i)
+    {
+        ASSERT_EQ(i, queue.Create(microseconds(random() % 100000000)));
+    }
+
+    for (int step = 0; step < 2000; ++step)
+    {
+        for (int change = 0; change < 10; ++change)
         {
-            return m_duration - TimeElapsed();
+            const TimerId id = random() % timersCount;
+            if (random() % 4 == 0)
+            {
+                queue.Stop(id);
+                scheduled[id] = false;
+            }
+            else
+            {
+                queue.Start(id);
+                scheduled[id] = true;
+                deadlines[id] = time.GetCurrent() + queue.TimeLeft(id);
+            }
         }
-        return s_zeroDuration;
+        time.Wait(microseconds(random() % 200000));
+
+        std::vector<TimerId> expected;
+        const TimePoint resolutionStart = TimePoint() + (time.GetCurrent() - TimePoint()) / resolution * resolution;
+        for (TimerId id = 0; id < timersCount; ++id)
+        {
+            if (scheduled[id] && deadlines[id] <= resolutionStart)
+            {
+                expected.push_back(id);
+                scheduled[id] = false;
+            }
+        }
+        std::vector<TimerId> expired;
+        queue.Advance([&expired](TimerId id) { expired.push_back(id); });
+        std::sort(expired.begin(), expired.end());
+        ASSERT_EQ(expected, expired) << "step " << step;
+        ASSERT_EQ(static_cast<size_t>(std::count(scheduled.begin(), scheduled.end(), true)), queue.ScheduledCount());
     }
+}
 
-private:
-    Duration TimeElapsed() const
+TEST(TimerWheel, MatchesBruteForce)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    CheckAgainstBruteForce(wheel, time, milliseconds(1));
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(TimerWheel, DISABLED_Benchmark)
+{
+    const size_t timersCount = 1000000;
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    std::mt19937 random(42);
+    std::vector<TimerId> ids;
+    for (size_t i = 0; i < timersCount; ++i)
     {
-        if (m_started)
+        ids.push_back(wheel.Create(milliseconds(1 + random() % 60000)));
+    }
+
+    auto measure = [](const char* name, size_t operations, Clock::time_point begin)
+    {
+        const double seconds = duration<double>(Clock::now() - begin).count();
+        std::cout << name << ": " << operations / seconds / 1e6 << " M operations per second" << std::endl;
+    };
+
+    Clock::time_point begin = Clock::now();
+    for (TimerId id : ids)
+    {
+        wheel.Start(id);
+    }
+    measure("start", timersCount, begin);
+
+    begin = Clock::now();
+    for (size_t i = 0; i < timersCount; ++i)
+    {
+        wheel.Start(ids[random() % timersCount]);
+    }
+    measure("restart", timersCount, begin);
+
+    begin = Clock::now();
+    for (size_t i = 0; i < timersCount / 10; ++i)
+    {
+        wheel.Stop(ids[random() % timersCount]);
+    }
+    measure("stop", timersCount / 10, begin);
+
+    // Every expired timer is started again, so the wheel keeps about 1M active timers
+    size_t expired = 0;
+    begin = Clock::now();
+    for (int tick = 0; tick < 120000; ++tick)
+    {
+        time.Wait(milliseconds(1));
+        expired += wheel.Advance([&wheel](TimerId id) { wheel.Start(id); });
+    }
+    measure("expire and restart", expired, begin);
+    std::cout << "active timers: " << wheel.ScheduledCount() << std::endl;
+}
+
+TEST(BinaryHeapTimerQueue, MatchesBruteForce)
+{
+    FakeTime time;
+    BinaryHeapTimerQueue queue(time);
+    CheckAgainstBruteForce(queue, time, Duration(1));
+}
+
+TEST(QuaternaryHeapTimerQueue, MatchesBruteForce)
+{
+    FakeTime time;
+    QuaternaryHeapTimerQueue queue(time);
+    CheckAgainstBruteForce(queue, time, Duration(1));
+}
+
+TEST(PairingHeapTimerQueue, MatchesBruteForce)
+{
+    FakeTime time;
+    PairingHeapTimerQueue queue(time);
+    CheckAgainstBruteForce(queue, time, Duration(1));
+}
+
+TEST(TimerQueues, ExpireAtDeadlineInOrder)
+{
+    FakeTime time;
+    TimerWheel wheel(time, milliseconds(1));
+    BinaryHeapTimerQueue binaryHeap(time);
+    QuaternaryHeapTimerQueue quaternaryHeap(time);
+    PairingHeapTimerQueue pairingHeap(time);
+    for (ITimerQueue* queue : std::vector<ITimerQueue*>{&wheel, &binaryHeap, &quaternaryHeap, &pairingHeap})
+    {
+        QueueTimer late(*queue, milliseconds(30));
+        QueueTimer early(*queue, milliseconds(10));
+        QueueTimer stopped(*queue, milliseconds(20));
+        late.Start();
+        early.Start();
+        stopped.Start();
+        stopped.Stop();
+        ASSERT_EQ(2u, queue->ScheduledCount());
+
+        std::vector<TimerId> expired;
+        auto collect = [&expired](TimerId id) { expired.push_back(id); };
+        time.Wait(milliseconds(9));
+        ASSERT_EQ(0u, queue->Advance(collect));
+        ASSERT_FALSE(early.IsExpired());
+        time.Wait(milliseconds(1));
+        ASSERT_TRUE(early.IsExpired());
+        ASSERT_EQ(1u, queue->Advance(collect));
+        time.Wait(milliseconds(100));
+        ASSERT_EQ(1u, queue->Advance(collect));
+        ASSERT_EQ(std::vector<TimerId>({early.Id(), late.Id()}), expired);
+        ASSERT_EQ(0u, queue->ScheduledCount());
+    }
+}
+
+struct ReplayOperation
+{
+    TimerId timer;
+    bool stop;
+};
+
+// Timers are started and stopped by the recorded steps of one millisecond,
+// periodic timers are started again when they expire
+struct TimerWorkload
+{
+    const char* name;
+    std::vector<Duration> durations;
+    std::vector<std::vector<ReplayOperation>> steps;
+    bool periodic;
+};
+
+// Every request starts a timeout, 95% of requests complete in 1-50 ms and stop it
+TimerWorkload MakeRpcTimeoutsWorkload(size_t stepsCount)
+{
+    TimerWorkload workload = {"rpc timeouts", {}, std::vector<std::vector<ReplayOperation>>(stepsCount), false};
+    std::mt19937 random(1);
+    const size_t requestsPerStep = 100;
+    const size_t timersCount = 200000;
+    for (size_t i = 0; i < timersCount; ++i)
+    {
+        workload.durations.push_back(milliseconds(1000 + random() % 4000));
+    }
+    TimerId next = 0;
+    for (size_t step = 0; step < stepsCount; ++step)
+    {
+        for (size_t request = 0; request < requestsPerStep; ++request)
         {
-            return m_time.GetCurrent() - m_startTime;
+            const TimerId timer = next;
+            next = (next + 1) % timersCount;
+            workload.steps[step].push_back(ReplayOperation{timer, false});
+            const size_t completion = step + 1 + random() % 50;
+            if (random() % 100 < 95 && completion < stepsCount)
+            {
+                workload.steps[completion].push_back(ReplayOperation{timer, true});
+            }
         }
-        return s_zeroDuration;
     }
+    return workload;
+}
 
-private:
-    ITime& m_time;
-    Duration m_duration;
-    bool m_started;
-    TimePoint m_startTime;
-};
+// Heartbeats with periods about a second, all started at once
+TimerWorkload MakeHeartbeatsWorkload(size_t stepsCount)
+{
+    TimerWorkload workload = {"heartbeats", {}, std::vector<std::vector<ReplayOperation>>(stepsCount), true};
+    std::mt19937 random(2);
+    const size_t timersCount = 100000;
+    for (TimerId timer = 0; timer < timersCount; ++timer)
+    {
+        workload.durations.push_back(milliseconds(900 + random() % 200));
+        workload.steps[0].push_back(ReplayOperation{timer, false});
+    }
+    return workload;
+}
 
-class FakeTime: public ITime
+// Random restarts and stops of timers from 10 ms to a minute
+TimerWorkload MakeMixedWorkload(size_t stepsCount)
 {
-public:
-    virtual TimePoint GetCurrent() { return m_current; }
+    TimerWorkload workload = {"mixed", {}, std::vector<std::vector<ReplayOperation>>(stepsCount), false};
+    std::mt19937 random(3);
+    const size_t timersCount = 100000;
+    for (size_t i = 0; i < timersCount; ++i)
+    {
+        workload.durations.push_back(milliseconds(10 + random() % 60000));
+    }
+    for (std::vector<ReplayOperation>& operations : workload.steps)
+    {
+        for (int i = 0; i < 250; ++i)
+        {
+            operations.push_back(ReplayOperation{static_cast<TimerId>(random() % timersCount), i % 5 == 0});
+        }
+    }
+    return workload;
+}
 
-    void Wait(Duration duration) { m_current += duration; }
+// Returns the number of starts, stops and expiries
+size_t ReplayWorkload(ITimerQueue& queue, FakeTime& time, const TimerWorkload& workload)
+{
+    for (Duration duration : workload.durations)
+    {
+        queue.Create(duration);
+    }
+    size_t operations = 0;
+    const ExpiredCallback onExpired = [&queue, &workload](TimerId id)
+    {
+        if (workload.periodic)
+        {
+            queue.Start(id);
+        }
+    };
+    for (const std::vector<ReplayOperation>& step : workload.steps)
+    {
+        for (const ReplayOperation& operation : step)
+        {
+            if (operation.stop)
+            {
+                queue.Stop(operation.timer);
+            }
+            else
+            {
+                queue.Start(operation.timer);
+            }
+        }
+        time.Wait(milliseconds(1));
+        operations += step.size() + queue.Advance(onExpired);
+    }
+    return operations;
+}
 
-private:
-    TimePoint m_current;
-};
+// Run with --gtest_also_run_disabled_tests
+TEST(TimerQueues, DISABLED_Benchmark)
+{
+    const size_t stepsCount = 20000;
+    const std::vector<TimerWorkload> workloads = {MakeRpcTimeoutsWorkload(stepsCount),
+                                                  MakeHeartbeatsWorkload(stepsCount),
+                                                  MakeMixedWorkload(stepsCount)};
+    typedef std::function<std::unique_ptr<ITimerQueue>(ITime&)> QueueFactory;
+    const std::vector<std::pair<const char*, QueueFactory>> backends = {
+        {"timer wheel", [](ITime& time) { return std::unique_ptr<ITimerQueue>(new TimerWheel(time, milliseconds(1))); }},
+        {"binary heap", [](ITime& time) { return std::unique_ptr<ITimerQueue>(new BinaryHeapTimerQueue(time)); }},
+        {"4-ary heap", [](ITime& time) { return std::unique_ptr<ITimerQueue>(new QuaternaryHeapTimerQueue(time)); }},
+        {"pairing heap", [](ITime& time) { return std::unique_ptr<ITimerQueue>(new PairingHeapTimerQueue(time)); }}};
 
-TEST(Timer, StartNoCheck)
+    for (const TimerWorkload& workload : workloads)
+    {
+        for (const auto& backend : backends)
+        {
+            FakeTime time;
+            std::unique_ptr<ITimerQueue> queue = backend.second(time);
+            const Clock::time_point begin = Clock::now();
+            const size_t operations = ReplayWorkload(*queue, time, workload);
+            const double seconds = duration<double>(Clock::now() - begin).count();
+            std::cout << workload.name << ", " << backend.first << ": " << seconds * 1e9 / operations
+                      << " ns per operation, " << operations << " operations" << std::endl;
+        }
+    }
+}
+
+TEST(TimerService, RunsExpiredCallbacksInOrder)
 {
     FakeTime time;
-    Timer timer(time, s_zeroDuration);
-    timer.Start();
+    TimerService service(time);
+    std::vector<int> calls;
+    service.Schedule(seconds(3), [&calls]() { calls.push_back(3); });
+    service.Schedule(seconds(1), [&calls]() { calls.push_back(1); });
+    service.Schedule(seconds(2), [&calls]() { calls.push_back(2); });
+    service.Schedule(seconds(1), [&calls]() { calls.push_back(4); });
+
+    ASSERT_EQ(0u, service.Dispatch());
+    time.Wait(seconds(1));
+    ASSERT_EQ(2u, service.Dispatch());
+    ASSERT_EQ(std::vector<int>({1, 4}), calls);
+    time.Wait(seconds(5));
+    ASSERT_EQ(2u, service.Dispatch());
+    ASSERT_EQ(std::vector<int>({1, 4, 2, 3}), calls);
+    ASSERT_EQ(0u, service.Dispatch());
 }
 
-TEST(Timer, IsExpired_NotStarted)
+TEST(TimerService, CancelledCallbackDoesNotRun)
 {
     FakeTime time;
-    Timer timer(time, s_zeroDuration);
-    ASSERT_TRUE(timer.IsExpired());
+    TimerService service(time);
+    bool called = false;
+    const CallbackId id = service.Schedule(seconds(1), [&called]() { called = true; });
+    service.Dispatch();
+    service.Cancel(id);
+    time.Wait(seconds(2));
+    ASSERT_EQ(0u, service.Dispatch());
+    ASSERT_FALSE(called);
+
+    TimePoint deadline;
+    ASSERT_FALSE(service.NextDeadline(deadline));
 }
 
-TEST(Timer, IsExpired_0AndStarted)
+TEST(TimerService, CancelBeforeDispatch)
 {
     FakeTime time;
-    Timer timer(time, s_zeroDuration);
-    timer.Start();
-    ASSERT_TRUE(timer.IsExpired());
+    TimerService service(time);
+    bool called = false;
+    service.Cancel(service.Schedule(s_zeroDuration, [&called]() { called = true; }));
+    ASSERT_EQ(0u, service.Dispatch());
+    ASSERT_FALSE(called);
 }
 
-TEST(Timer, IsExpired_Not0AndStarted)
+TEST(TimerService, NextDeadline)
 {
     FakeTime time;
-    Timer timer(time, seconds(1));
-    timer.Start();
-    ASSERT_FALSE(timer.IsExpired());
+    time.Wait(seconds(10));
+    TimerService service(time);
+    service.Schedule(seconds(5), []() { });
+    const CallbackId id = service.Schedule(seconds(2), []() { });
+    service.Dispatch();
+    TimePoint deadline;
+    ASSERT_TRUE(service.NextDeadline(deadline));
+    ASSERT_EQ(time.GetCurrent() + seconds(2), deadline);
+
+    service.Cancel(id);
+    service.Dispatch();
+    ASSERT_TRUE(service.NextDeadline(deadline));
+    ASSERT_EQ(time.GetCurrent() + seconds(5), deadline);
 }
 
-TEST(Timer, TimeLeft_NotStarted)
+TEST(TimerService, CallbackSchedulesAnother)
 {
     FakeTime time;
-    Timer timer(time, seconds(1));
-    ASSERT_EQ(seconds(0), timer.TimeLeft());
+    TimerService service(time);
+    int calls = 0;
+    std::function<void()> periodic = [&]() { ++calls; service.Schedule(seconds(1), periodic); };
+    service.Schedule(seconds(1), periodic);
+    for (int i = 0; i < 10; ++i)
+    {
+        time.Wait(seconds(1));
+        service.Dispatch();
+    }
+    ASSERT_EQ(10, calls);
 }
 
-TEST(Timer, TimeLeft_Started)
+TEST(TimerService, ConcurrentProducers)
 {
     FakeTime time;
-    Timer timer(time, seconds(1));
-    timer.Start();
-    ASSERT_EQ(seconds(1), timer.TimeLeft());
+    TimerService service(time);
+    const size_t producersCount = 4;
+    const size_t callbacksCount = 10000;
+    std::atomic<size_t> calls(0);
+    std::vector<std::thread> producers;
+    for (size_t producer = 0; producer < producersCount; ++producer)
+    {
+        producers.emplace_back([&service, &calls]()
+        {
+            for (size_t i = 0; i < callbacksCount; ++i)
+            {
+                // Cancelled callbacks can't expire before the time moves after all producers are done
+                const bool cancel = i % 2 == 0;
+                const CallbackId id = service.Schedule(cancel ? seconds(1) : s_zeroDuration, [&calls]() { ++calls; });
+                if (cancel)
+                {
+                    service.Cancel(id);
+                }
+            }
+        });
+    }
+    size_t dispatched = 0;
+    while (dispatched < producersCount * callbacksCount / 2)
+    {
+        dispatched += service.Dispatch();
+    }
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+    time.Wait(seconds(2));
+    ASSERT_EQ(0u, service.Dispatch());
+    TimePoint deadline;
+    ASSERT_FALSE(service.NextDeadline(deadline));
+    ASSERT_EQ(producersCount * callbacksCount / 2, calls.load());
 }
 
-TEST(Timer, TimeLeft_Started2)
+TEST(TimerService, DispatcherThread)
+{
+    SystemTime time;
+    TimerService service(time);
+    service.StartDispatcher();
+    std::promise<void> called;
+    const Clock::time_point begin = Clock::now();
+    service.Schedule(milliseconds(20), [&called]() { called.set_value(); });
+    ASSERT_EQ(std::future_status::ready, called.get_future().wait_for(seconds(5)));
+    ASSERT_GE(Clock::now() - begin, milliseconds(20));
+    service.StopDispatcher();
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(TimerService, DISABLED_Benchmark)
+{
+    SystemTime time;
+    TimerService service(time);
+    service.StartDispatcher();
+
+    const size_t producersCount = 4;
+    const size_t callbacksCount = 20000;
+    std::vector<Duration> lateness(producersCount * callbacksCount);
+    std::atomic<size_t> calls(0);
+    std::vector<std::thread> producers;
+    const Clock::time_point begin = Clock::now();
+    for (size_t producer = 0; producer < producersCount; ++producer)
+    {
+        producers.emplace_back([&, producer]()
+        {
+            std::mt19937 random(static_cast<unsigned>(producer));
+            for (size_t i = 0; i < callbacksCount; ++i)
+            {
+                const Duration delay = microseconds(1000 + random() % 20000);
+                const TimePoint expected = time.GetCurrent() + delay;
+                Duration& result = lateness[producer * callbacksCount + i];
+                service.Schedule(delay, [&result, &calls, expected]()
+                {
+                    result = Clock::now() - expected;
+                    calls.fetch_add(1, std::memory_order_release);
+                });
+                if (i % 64 == 0)
+                {
+                    std::this_thread::sleep_for(microseconds(100));
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+    while (calls.load(std::memory_order_acquire) < lateness.size())
+    {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    const double seconds = duration<double>(Clock::now() - begin).count();
+    service.StopDispatcher();
+
+    std::sort(lateness.begin(), lateness.end());
+    auto percentile = [&lateness](double fraction)
+    {
+        return duration_cast<microseconds>(lateness[static_cast<size_t>(fraction * (lateness.size() - 1))]).count();
+    };
+    std::cout << lateness.size() / seconds << " callbacks per second, lateness in us: p50 " << percentile(0.5)
+              << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99) << ", max " << percentile(1.0) << std::endl;
+}
+
+TEST(PeriodicTimer, NotStarted)
 {
     FakeTime time;
-    Timer timer(time, seconds(2));
-    timer.Start();
-    ASSERT_EQ(seconds(2), timer.TimeLeft());
+    PeriodicTimer timer(time, seconds(10));
+    ASSERT_TRUE(timer.IsExpired());
+    ASSERT_EQ(s_zeroDuration, timer.TimeLeft());
+    ASSERT_EQ(0u, timer.Consume());
 }
 
-TEST(Timer, TimeLeft_Started_AfterWaiting)
+TEST(PeriodicTimer, RejectsNonPositivePeriod)
 {
     FakeTime time;
-    Timer timer(time, seconds(2));
+    EXPECT_THROW(PeriodicTimer(time, s_zeroDuration), std::invalid_argument);
+    EXPECT_THROW(PeriodicTimer(time, seconds(-1)), std::invalid_argument);
+}
+
+TEST(PeriodicTimer, ConsumesExpiredPeriods)
+{
+    FakeTime time;
+    PeriodicTimer timer(time, seconds(10));
     timer.Start();
+    time.Wait(seconds(9));
+    ASSERT_FALSE(timer.IsExpired());
+    ASSERT_EQ(0u, timer.Consume());
     time.Wait(seconds(1));
-    ASSERT_EQ(seconds(1), timer.TimeLeft());
+    ASSERT_TRUE(timer.IsExpired());
+    ASSERT_EQ(1u, timer.Consume());
+    ASSERT_FALSE(timer.IsExpired());
+    time.Wait(seconds(25));
+    ASSERT_EQ(2u, timer.Consume());
+    ASSERT_EQ(seconds(5), timer.TimeLeft());
 }
 
-TEST(Timer, TimeLeft_Started_AfterWaiting2)
+TEST(PeriodicTimer, LatePollingDoesNotDrift)
 {
     FakeTime time;
-    Timer timer(time, seconds(10));
-    timer.Start();
-    time.Wait(seconds(3));
-    ASSERT_EQ(seconds(7), timer.TimeLeft());
+    PeriodicTimer periodic(time, seconds(10));
+    Timer restarted(time, seconds(10));
+    periodic.Start();
+    restarted.Start();
+    size_t periods = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        time.Wait(seconds(13));
+        periods += periodic.Consume();
+        ASSERT_TRUE(restarted.IsExpired());
+        restarted.Start();
+    }
+    // 65 seconds passed: periods ended at 10, 20, ... 60 and the next one ends at 70,
+    // while the restarted timer drifted to 75
+    ASSERT_EQ(6u, periods);
+    ASSERT_EQ(seconds(5), periodic.TimeLeft());
+    ASSERT_EQ(seconds(10), restarted.TimeLeft());
 }
 
-TEST(Timer, TimeLeft_Wait_Started_AfterWaiting)
+TEST(PeriodicTimer, ConcurrentConsumersClaimEveryPeriodOnce)
 {
     FakeTime time;
-    time.Wait(seconds(5));
-    Timer timer(time, seconds(10));
+    PeriodicTimer timer(time, milliseconds(1));
     timer.Start();
-    time.Wait(seconds(3));
-    ASSERT_EQ(seconds(7), timer.TimeLeft());
+    time.Wait(seconds(1));
+    std::atomic<size_t> claimed(0);
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 4; ++i)
+    {
+        consumers.emplace_back([&timer, &claimed]()
+        {
+            for (int call = 0; call < 1000; ++call)
+            {
+                claimed += timer.Consume();
+            }
+        });
+    }
+    for (std::thread& consumer : consumers)
+    {
+        consumer.join();
+    }
+    ASSERT_EQ(1000u, claimed.load());
 }
 
-TEST(Timer, TimeLeft_Expired)
+TEST(TokenBucket, StartsFull)
 {
     FakeTime time;
-    time.Wait(seconds(2));
-    Timer timer(time, seconds(4));
-    timer.Start();
-    time.Wait(seconds(6));
-    ASSERT_EQ(seconds(0), timer.TimeLeft());
+    TokenBucket bucket(time, milliseconds(100), 5);
+    ASSERT_EQ(5u, bucket.Available());
+    ASSERT_TRUE(bucket.TryAcquire(3));
+    ASSERT_TRUE(bucket.TryAcquire(2));
+    ASSERT_FALSE(bucket.TryAcquire());
+    ASSERT_EQ(0u, bucket.Available());
 }
 
-TEST(Timer, IsExpired_NoTimeLeft)
+TEST(TokenBucket, RejectsNonPositiveInterval)
 {
     FakeTime time;
-    time.Wait(seconds(2));
-    Timer timer(time, seconds(3));
-    timer.Start();
-    time.Wait(seconds(6));
-    ASSERT_TRUE(timer.IsExpired());
+    EXPECT_THROW(TokenBucket(time, s_zeroDuration, 10), std::invalid_argument);
+    EXPECT_THROW(TokenBucket(time, milliseconds(-1), 10), std::invalid_argument);
 }
 
-TEST(Timer, IsExpired_TimeIsLeft)
+TEST(TokenBucket, Refills)
 {
     FakeTime time;
-    time.Wait(seconds(2));
-    Timer timer(time, seconds(5));
-    timer.Start();
-    time.Wait(seconds(2));
-    ASSERT_FALSE(timer.IsExpired());
+    TokenBucket bucket(time, milliseconds(100), 5);
+    ASSERT_TRUE(bucket.TryAcquire(5));
+    time.Wait(milliseconds(99));
+    ASSERT_FALSE(bucket.TryAcquire());
+    time.Wait(milliseconds(1));
+    ASSERT_TRUE(bucket.TryAcquire());
+    ASSERT_FALSE(bucket.TryAcquire());
+    time.Wait(milliseconds(250));
+    ASSERT_EQ(2u, bucket.Available());
+    ASSERT_FALSE(bucket.TryAcquire(3));
+    ASSERT_TRUE(bucket.TryAcquire(2));
 }
 
-TEST(Timer, IsExpired_TimeLeaft_AfterTimerRestart)
+TEST(TokenBucket, DoesNotOverfill)
 {
     FakeTime time;
-    time.Wait(seconds(1));
-    Timer timer(time, seconds(5));
-    timer.Start();
-    time.Wait(seconds(2));
-    ASSERT_EQ(seconds(3), timer.TimeLeft());
+    TokenBucket bucket(time, milliseconds(100), 5);
+    time.Wait(hours(1));
+    ASSERT_EQ(5u, bucket.Available());
+    ASSERT_FALSE(bucket.TryAcquire(6));
+    ASSERT_TRUE(bucket.TryAcquire(5));
+    ASSERT_FALSE(bucket.TryAcquire());
+}
 
-    // Restarting the timer
-    timer.Start();
-    ASSERT_EQ(seconds(5), timer.TimeLeft());
+TEST(TokenBucket, ConcurrentCallersGetCapacity)
+{
+    FakeTime time;
+    TokenBucket bucket(time, milliseconds(1), 1000);
+    std::atomic<size_t> acquired(0);
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 4; ++i)
+    {
+        callers.emplace_back([&bucket, &acquired]()
+        {
+            for (int call = 0; call < 1000; ++call)
+            {
+                acquired += bucket.TryAcquire() ? 1 : 0;
+            }
+        });
+    }
+    for (std::thread& caller : callers)
+    {
+        caller.join();
+    }
+    ASSERT_EQ(1000u, acquired.load());
 }
 
+// Run with --gtest_also_run_disabled_tests
+TEST(TokenBucket, DISABLED_Benchmark)
+{
+    CoarseTime time(milliseconds(1));
+    const size_t rate = 1000000;
+    const Duration runTime = seconds(1);
+    for (size_t threadsCount = 1; threadsCount <= 8; threadsCount *= 2)
+    {
+        TokenBucket bucket(time, duration_cast<Duration>(seconds(1)) / rate, rate / 100);
+        std::atomic<size_t> calls(0);
+        std::atomic<size_t> acquired(0);
+        std::vector<std::thread> callers;
+        const Clock::time_point begin = Clock::now();
+        for (size_t i = 0; i < threadsCount; ++i)
+        {
+            callers.emplace_back([&]()
+            {
+                size_t localCalls = 0;
+                size_t localAcquired = 0;
+                while (Clock::now() - begin < runTime)
+                {
+                    for (int call = 0; call < 1000; ++call)
+                    {
+                        localAcquired += bucket.TryAcquire() ? 1 : 0;
+                    }
+                    localCalls += 1000;
+                }
+                calls += localCalls;
+                acquired += localAcquired;
+            });
+        }
+        for (std::thread& caller : callers)
+        {
+            caller.join();
+        }
+        const double seconds = duration<double>(Clock::now() - begin).count();
+        std::cout << threadsCount << " threads: " << calls / seconds / 1e6 << " M TryAcquire per second, "
+                  << acquired / seconds / 1e6 << " M tokens per second of " << rate / 1e6 << std::endl;
+    }
+}
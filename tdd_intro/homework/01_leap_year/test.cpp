@@ -13,3 +13,685 @@ If your language provides a method in the standard library that does this look-u
 */
 
 #include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Only x86-64 guarantees SSE2. LEAP_YEAR_NO_SSE2 builds the scalar tail for every year.
+#if !defined(LEAP_YEAR_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LEAP_YEAR_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Architecture:
+ * Year is leap if it is divisible by 4 and either not divisible by 25 or divisible by 16,
+ * that is the same as the 4/100/400 rule because 100 = 4 * 25 and 400 = 16 * 25.
+ * Divisibility by 4 and 16 is checked with a bit mask.
+ * Divisibility by 25 is checked without division: multiplying by the inverse of 25 modulo 2^32
+ * maps multiples of 25 exactly to the quotients, which are the only values of [-c, c]
+ * with c = (2^31 - 1) / 25, shifting by c turns it into one unsigned comparison.
+ * The predicate has no branches, so the SSE2 batch kernel does the same for 16 years at once.
+*/
+
+static const uint32_t s_inverseOf25 = 0xC28F5C29;   // 25 * s_inverseOf25 == 1 modulo 2^32
+static const uint32_t s_quotientBound25 = 85899345; // (2^31 - 1) / 25
+
+constexpr bool IsDivisibleBy25(int32_t year)
+{
+    return static_cast<uint32_t>(static_cast<uint32_t>(year) * s_inverseOf25 + s_quotientBound25) <= 2 * s_quotientBound25;
+}
+
+constexpr bool IsLeapYear(int32_t year)
+{
+    return ((year & 3) == 0) & (!IsDivisibleBy25(year) | ((year & 15) == 0));
+}
+
+// Straightforward rule with divisions
+constexpr bool IsLeapYearReference(int32_t year)
+{
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+#ifdef LEAP_YEAR_SSE2
+// SSE2 has no 32-bit low multiplication, even and odd lanes are multiplied separately
+inline __m128i MultiplyLow32(__m128i a, __m128i b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// All bits of a lane are set for leap years
+inline __m128i LeapYearMask(__m128i years)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i signBit = _mm_set1_epi32(static_cast<int32_t>(0x80000000u));
+    const __m128i divisibleBy4 = _mm_cmpeq_epi32(_mm_and_si128(years, _mm_set1_epi32(3)), zero);
+    const __m128i divisibleBy16 = _mm_cmpeq_epi32(_mm_and_si128(years, _mm_set1_epi32(15)), zero);
+
+    // Unsigned comparison is a signed one with flipped sign bits
+    const __m128i shifted = _mm_add_epi32(MultiplyLow32(years, _mm_set1_epi32(static_cast<int32_t>(s_inverseOf25))),
+                                          _mm_set1_epi32(static_cast<int32_t>(s_quotientBound25)));
+    const __m128i notDivisibleBy25 = _mm_cmpgt_epi32(_mm_xor_si128(shifted, signBit),
+                                                     _mm_set1_epi32(static_cast<int32_t>((2 * s_quotientBound25) ^ 0x80000000u)));
+    return _mm_and_si128(divisibleBy4, _mm_or_si128(notDivisibleBy25, divisibleBy16));
+}
+#endif
+
+// Writes 1 for leap years and 0 for others
+void ClassifyLeapYears(const int32_t* years, size_t count, uint8_t* leap)
+{
+    size_t pos = 0;
+#ifdef LEAP_YEAR_SSE2
+    const __m128i one = _mm_set1_epi8(1);
+    for (; pos + 16 <= count; pos += 16)
+    {
+        const __m128i* block = reinterpret_cast<const __m128i*>(years + pos);
+        const __m128i low = _mm_packs_epi32(LeapYearMask(_mm_loadu_si128(block)), LeapYearMask(_mm_loadu_si128(block + 1)));
+        const __m128i high = _mm_packs_epi32(LeapYearMask(_mm_loadu_si128(block + 2)), LeapYearMask(_mm_loadu_si128(block + 3)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(leap + pos), _mm_and_si128(_mm_packs_epi16(low, high), one));
+    }
+#endif
+    for (; pos < count; ++pos)
+    {
+        leap[pos] = IsLeapYear(years[pos]);
+    }
+}
+
+/*
+ * Civil dates:
+ * Dates are counted in days since 01.01.1970 of the proleptic Gregorian calendar.
+ * Conversions follow Neri and Schneider: the computational calendar starts years in March,
+ * so the leap day is the last day of a year and month lengths follow a linear function.
+ * Years are shifted by 82 cycles of 400 years, so all the arithmetic is done on unsigned 32-bit values.
+ * Every division is by a constant, so it is a multiplication, and there are no loops over years.
+ * Supported epoch days are from s_minEpochDay (01.03.-32800) to s_maxEpochDay (about year 1,430,000).
+ * The batch conversion runs the same steps for 4 days per SSE2 vector,
+ * divisions are done by multiplications by magic numbers which are exact on this range.
+*/
+
+struct CivilDate
+{
+    int32_t year;
+    uint32_t month;
+    uint32_t day;
+
+    constexpr bool operator==(const CivilDate& other) const
+    {
+        return year == other.year && month == other.month && day == other.day;
+    }
+};
+
+static constexpr uint32_t s_civilCycles = 82;
+static constexpr int32_t s_civilYearShift = 400 * s_civilCycles;
+static constexpr uint32_t s_civilDayShift = 719468 + 146097 * s_civilCycles;
+static constexpr int32_t s_minEpochDay = -static_cast<int32_t>(s_civilDayShift);
+static constexpr int32_t s_maxEpochDay = (1 << 29) - 1 - static_cast<int32_t>(s_civilDayShift);
+
+static constexpr uint32_t s_daysBeforeMonth[13] = {0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+constexpr uint32_t DaysInMonth(int32_t year, uint32_t month)
+{
+    return month == 2 ? 28 + IsLeapYear(year) : 30 + ((month + (month >> 3)) & 1);
+}
+
+constexpr bool IsValidDate(const CivilDate& date)
+{
+    return date.month >= 1 && date.month <= 12 && date.day >= 1 && date.day <= DaysInMonth(date.year, date.month);
+}
+
+// From 1 for the first of January
+constexpr uint32_t DayOfYear(const CivilDate& date)
+{
+    return s_daysBeforeMonth[date.month] + date.day + (date.month > 2 && IsLeapYear(date.year));
+}
+
+constexpr int32_t DaysFromCivil(const CivilDate& date)
+{
+    const uint32_t january = date.month <= 2;
+    const uint32_t year = static_cast<uint32_t>(date.year + s_civilYearShift) - january;
+    const uint32_t month = date.month + 12 * january;
+    const uint32_t century = year / 100;
+    const uint32_t daysBeforeYear = 1461 * year / 4 - century + century / 4;
+    const uint32_t daysBeforeMonth = (979 * month - 2919) / 32;
+    return static_cast<int32_t>(daysBeforeYear + daysBeforeMonth + date.day - 1 - s_civilDayShift);
+}
+
+constexpr CivilDate CivilFromDays(int32_t epochDay)
+{
+    const uint32_t n1 = 4 * (static_cast<uint32_t>(epochDay) + s_civilDayShift) + 3;
+    const uint32_t century = n1 / 146097;
+    const uint32_t dayOfCentury = n1 % 146097 / 4;
+    const uint32_t yearOfCentury = static_cast<uint32_t>((uint64_t(2939745) * (4 * dayOfCentury + 3)) >> 32);
+    const uint32_t dayOfYear = dayOfCentury - 365 * yearOfCentury - yearOfCentury / 4;
+    const uint32_t n3 = 2141 * dayOfYear + 197913;
+    const uint32_t january = dayOfYear >= 306;
+    return CivilDate{static_cast<int32_t>(100 * century + yearOfCentury) - s_civilYearShift + static_cast<int32_t>(january),
+                     (n3 >> 16) - 12 * january,
+                     (n3 & 0xFFFF) / 2141 + 1};
+}
+
+constexpr int32_t DaysBetween(const CivilDate& from, const CivilDate& to)
+{
+    return DaysFromCivil(to) - DaysFromCivil(from);
+}
+
+// Parses "DD.MM.YYYY", returns false for other formats and invalid dates
+constexpr bool ParseDate(std::string_view text, CivilDate& date)
+{
+    if (text.size() != 10 || text[2] != '.' || text[5] != '.')
+    {
+        return false;
+    }
+    uint32_t values[3] = {};
+    const size_t starts[3] = {0, 3, 6};
+    const size_t lengths[3] = {2, 2, 4};
+    for (size_t field = 0; field < 3; ++field)
+    {
+        for (size_t i = starts[field]; i < starts[field] + lengths[field]; ++i)
+        {
+            const uint32_t digit = static_cast<uint32_t>(text[i] - '0');
+            if (digit > 9)
+            {
+                return false;
+            }
+            values[field] = values[field] * 10 + digit;
+        }
+    }
+    const CivilDate parsed = {static_cast<int32_t>(values[2]), values[1], values[0]};
+    if (!IsValidDate(parsed))
+    {
+        return false;
+    }
+    date = parsed;
+    return true;
+}
+
+// "DD.MM.YYYY" for years from 0 to 9999
+std::string FormatDate(const CivilDate& date)
+{
+    std::string text = "00.00.0000";
+    text[0] = static_cast<char>('0' + date.day / 10);
+    text[1] = static_cast<char>('0' + date.day % 10);
+    text[3] = static_cast<char>('0' + date.month / 10);
+    text[4] = static_cast<char>('0' + date.month % 10);
+    uint32_t year = static_cast<uint32_t>(date.year);
+    for (size_t i = 9; i >= 6; --i, year /= 10)
+    {
+        text[i] = static_cast<char>('0' + year % 10);
+    }
+    return text;
+}
+
+#ifdef LEAP_YEAR_SSE2
+// High part of 32 by 32 bit products shifted right, Shift is at least 32
+template <int Shift>
+inline __m128i MultiplyShiftRight(__m128i values, uint32_t multiplier)
+{
+    const __m128i factor = _mm_set1_epi32(static_cast<int32_t>(multiplier));
+    const __m128i even = _mm_srli_epi64(_mm_mul_epu32(values, factor), Shift);
+    const __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(values, 32), factor), Shift);
+    return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+// Products of small values are done by pmaddwd: lanes hold values below 2^15 in their low halves
+inline __m128i MultiplySmall(__m128i values, int16_t factor)
+{
+    return _mm_madd_epi16(values, _mm_set1_epi32(factor));
+}
+
+inline void CivilFromDaysVector(__m128i epochDays, __m128i& years, __m128i& months, __m128i& days)
+{
+    const __m128i n1 = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(epochDays, _mm_set1_epi32(s_civilDayShift)), 2),
+                                     _mm_set1_epi32(3));
+    // n1 / 146097 is exact for n1 below 2^31, century * 146097 is split as century * 15025 + century * 2^17
+    const __m128i century = MultiplyShiftRight<49>(n1, 3853261556u);
+    const __m128i centuryDays = _mm_add_epi32(MultiplySmall(century, 15025), _mm_slli_epi32(century, 17));
+    const __m128i dayOfCentury = _mm_srli_epi32(_mm_sub_epi32(n1, centuryDays), 2);
+    const __m128i yearOfCentury = MultiplyShiftRight<32>(
+        _mm_add_epi32(_mm_slli_epi32(dayOfCentury, 2), _mm_set1_epi32(3)), 2939745);
+    const __m128i dayOfYear = _mm_sub_epi32(dayOfCentury, _mm_add_epi32(MultiplySmall(yearOfCentury, 365),
+                                                                        _mm_srli_epi32(yearOfCentury, 2)));
+    const __m128i n3 = _mm_add_epi32(MultiplySmall(dayOfYear, 2141), _mm_set1_epi32(197913));
+    // All bits are set for January and February
+    const __m128i january = _mm_cmpgt_epi32(dayOfYear, _mm_set1_epi32(305));
+
+    years = _mm_sub_epi32(_mm_sub_epi32(_mm_add_epi32(MultiplySmall(century, 100), yearOfCentury),
+                                        _mm_set1_epi32(s_civilYearShift)),
+                          january);
+    months = _mm_sub_epi32(_mm_srli_epi32(n3, 16), _mm_and_si128(january, _mm_set1_epi32(12)));
+    // (n3 & 0xFFFF) / 2141 is (n3 & 0xFFFF) * 62690 >> 27, exact for 16-bit values
+    days = _mm_add_epi32(_mm_srli_epi32(_mm_mulhi_epu16(_mm_and_si128(n3, _mm_set1_epi32(0xFFFF)), _mm_set1_epi32(62690)), 11),
+                         _mm_set1_epi32(1));
+}
+#endif
+
+// Converts epoch days into separate arrays of years, months and days
+void CivilFromDaysBatch(const int32_t* epochDays, size_t count, int32_t* years, uint8_t* months, uint8_t* days)
+{
+    size_t pos = 0;
+#ifdef LEAP_YEAR_SSE2
+    for (; pos + 16 <= count; pos += 16)
+    {
+        __m128i blockMonths[4];
+        __m128i blockDays[4];
+        for (size_t part = 0; part < 4; ++part)
+        {
+            __m128i partYears;
+            CivilFromDaysVector(_mm_loadu_si128(reinterpret_cast<const __m128i*>(epochDays + pos + 4 * part)),
+                                partYears, blockMonths[part], blockDays[part]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(years + pos + 4 * part), partYears);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(months + pos),
+                         _mm_packus_epi16(_mm_packs_epi32(blockMonths[0], blockMonths[1]),
+                                          _mm_packs_epi32(blockMonths[2], blockMonths[3])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(days + pos),
+                         _mm_packus_epi16(_mm_packs_epi32(blockDays[0], blockDays[1]),
+                                          _mm_packs_epi32(blockDays[2], blockDays[3])));
+    }
+#endif
+    for (; pos < count; ++pos)
+    {
+        const CivilDate date = CivilFromDays(epochDays[pos]);
+        years[pos] = date.year;
+        months[pos] = static_cast<uint8_t>(date.month);
+        days[pos] = static_cast<uint8_t>(date.day);
+    }
+}
+
+static_assert(IsLeapYear(2000) && !IsLeapYear(1900) && IsLeapYear(1996) && !IsLeapYear(1997), "Leap year rule");
+
+TEST(LeapYear, DivisibleBy4)
+{
+    EXPECT_TRUE(IsLeapYear(1996));
+    EXPECT_TRUE(IsLeapYear(2016));
+}
+
+TEST(LeapYear, NotDivisibleBy4)
+{
+    EXPECT_FALSE(IsLeapYear(1997));
+    EXPECT_FALSE(IsLeapYear(2019));
+}
+
+TEST(LeapYear, DivisibleBy100)
+{
+    EXPECT_FALSE(IsLeapYear(1900));
+    EXPECT_FALSE(IsLeapYear(2100));
+}
+
+TEST(LeapYear, DivisibleBy400)
+{
+    EXPECT_TRUE(IsLeapYear(2000));
+    EXPECT_TRUE(IsLeapYear(1600));
+}
+
+TEST(LeapYear, ProlepticYears)
+{
+    EXPECT_TRUE(IsLeapYear(0));
+    EXPECT_FALSE(IsLeapYear(-100));
+    EXPECT_TRUE(IsLeapYear(-400));
+    EXPECT_TRUE(IsLeapYear(-4));
+    EXPECT_FALSE(IsLeapYear(-1));
+}
+
+TEST(LeapYear, MatchesReferenceExhaustively)
+{
+    for (int32_t year = -4000000; year <= 4000000; ++year)
+    {
+        ASSERT_EQ(IsLeapYearReference(year), IsLeapYear(year)) << year;
+    }
+}
+
+TEST(LeapYear, MatchesReferenceOverWholeRange)
+{
+    for (int64_t year = std::numeric_limits<int32_t>::min(); year <= std::numeric_limits<int32_t>::max(); year += 9973)
+    {
+        ASSERT_EQ(IsLeapYearReference(static_cast<int32_t>(year)), IsLeapYear(static_cast<int32_t>(year))) << year;
+    }
+    for (int32_t year : {std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min() + 400,
+                         std::numeric_limits<int32_t>::max() - 400, std::numeric_limits<int32_t>::max()})
+    {
+        for (int32_t offset = 0; offset < 400; ++offset)
+        {
+            const int32_t shifted = year < 0 ? year + offset : year - offset;
+            ASSERT_EQ(IsLeapYearReference(shifted), IsLeapYear(shifted)) << shifted;
+        }
+    }
+}
+
+TEST(LeapYear, BatchMatchesReference)
+{
+    std::vector<int32_t> years;
+    for (int32_t year = -400000; year <= 400000; ++year)
+    {
+        years.push_back(year);
+    }
+    std::mt19937 random(42);
+    for (int i = 0; i < 100000; ++i)
+    {
+        years.push_back(static_cast<int32_t>(random()));
+    }
+
+    // Odd offsets and counts cover unaligned blocks and the scalar tail
+    for (size_t offset = 0; offset < 3; ++offset)
+    {
+        const size_t count = years.size() - offset - 5;
+        std::vector<uint8_t> leap(count, 2);
+        ClassifyLeapYears(years.data() + offset, count, leap.data());
+        for (size_t i = 0; i < count; ++i)
+        {
+            ASSERT_EQ(IsLeapYearReference(years[offset + i]) ? 1 : 0, leap[i]) << years[offset + i];
+        }
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(LeapYear, DISABLED_Benchmark)
+{
+    const size_t count = 16 * 1024 * 1024;
+    const int repeats = 10;
+    std::vector<int32_t> years(count);
+    std::mt19937 random(42);
+    for (int32_t& year : years)
+    {
+        year = static_cast<int32_t>(random() % 10000);
+    }
+    std::vector<uint8_t> leap(count);
+
+    auto measure = [&](const char* name, void (*classify)(const int32_t*, size_t, uint8_t*))
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < repeats; ++repeat)
+        {
+            classify(years.data(), count, leap.data());
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        size_t leapCount = 0;
+        for (uint8_t value : leap)
+        {
+            leapCount += value;
+        }
+        std::cout << name << ": " << count * sizeof(int32_t) * repeats / seconds / 1e9 << " GB/s of years, "
+                  << leapCount << " leap years" << std::endl;
+    };
+
+    measure("reference", [](const int32_t* years, size_t count, uint8_t* leap)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            leap[i] = IsLeapYearReference(years[i]);
+        }
+    });
+    measure("branchless scalar", [](const int32_t* years, size_t count, uint8_t* leap)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            leap[i] = IsLeapYear(years[i]);
+        }
+    });
+    measure("batch", ClassifyLeapYears);
+}
+
+static_assert(DaysFromCivil(CivilDate{1970, 1, 1}) == 0, "Epoch");
+static_assert(CivilFromDays(17774) == CivilDate{2018, 8, 31}, "Civil from days");
+
+std::time_t UtcTimeFromCalendar(std::tm& calendar)
+{
+#ifdef _WIN32
+    return _mkgmtime(&calendar);
+#else
+    return timegm(&calendar);
+#endif
+}
+
+std::tm UtcCalendarFromTime(std::time_t time)
+{
+    std::tm calendar = {};
+#ifdef _WIN32
+    gmtime_s(&calendar, &time);
+#else
+    gmtime_r(&time, &calendar);
+#endif
+    return calendar;
+}
+
+// Next date by month lengths only
+CivilDate NextDate(CivilDate date)
+{
+    if (++date.day > DaysInMonth(date.year, date.month))
+    {
+        date.day = 1;
+        if (++date.month > 12)
+        {
+            date.month = 1;
+            ++date.year;
+        }
+    }
+    return date;
+}
+
+TEST(CivilDate, DaysInMonth)
+{
+    const uint32_t expected[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    for (uint32_t month = 1; month <= 12; ++month)
+    {
+        EXPECT_EQ(expected[month - 1], DaysInMonth(2019, month)) << month;
+    }
+    EXPECT_EQ(29u, DaysInMonth(2020, 2));
+    EXPECT_EQ(28u, DaysInMonth(1900, 2));
+}
+
+TEST(CivilDate, DayOfYear)
+{
+    EXPECT_EQ(1u, DayOfYear(CivilDate{2018, 1, 1}));
+    EXPECT_EQ(243u, DayOfYear(CivilDate{2018, 8, 31}));
+    EXPECT_EQ(244u, DayOfYear(CivilDate{2020, 8, 31}));
+    EXPECT_EQ(366u, DayOfYear(CivilDate{2000, 12, 31}));
+}
+
+TEST(CivilDate, DaysBetween)
+{
+    EXPECT_EQ(365, DaysBetween(CivilDate{2018, 8, 31}, CivilDate{2019, 8, 31}));
+    EXPECT_EQ(-366, DaysBetween(CivilDate{2020, 8, 31}, CivilDate{2019, 8, 31}));
+    EXPECT_EQ(146097, DaysBetween(CivilDate{1600, 3, 1}, CivilDate{2000, 3, 1}));
+}
+
+TEST(CivilDate, MatchesDayByDayCount)
+{
+    CivilDate date = {-2000, 1, 1};
+    for (int32_t epochDay = DaysFromCivil(date); date.year < 4000; ++epochDay, date = NextDate(date))
+    {
+        ASSERT_EQ(epochDay, DaysFromCivil(date)) << date.year << "." << date.month << "." << date.day;
+        ASSERT_EQ(date, CivilFromDays(epochDay)) << epochDay;
+    }
+}
+
+TEST(CivilDate, SupportedRangeBounds)
+{
+    EXPECT_EQ((CivilDate{-32800, 3, 1}), CivilFromDays(s_minEpochDay));
+    for (int32_t epochDay : {s_minEpochDay, s_minEpochDay + 1, s_maxEpochDay - 1, s_maxEpochDay})
+    {
+        EXPECT_EQ(epochDay, DaysFromCivil(CivilFromDays(epochDay))) << epochDay;
+        EXPECT_EQ(CivilFromDays(epochDay + 1), NextDate(CivilFromDays(epochDay))) << epochDay;
+    }
+}
+
+TEST(CivilDate, MatchesTimegm)
+{
+    for (int32_t epochDay = 0; epochDay < 25000; ++epochDay)
+    {
+        const std::tm calendar = UtcCalendarFromTime(static_cast<std::time_t>(epochDay) * 86400);
+        const CivilDate date = CivilFromDays(epochDay);
+        ASSERT_EQ(calendar.tm_year + 1900, date.year);
+        ASSERT_EQ(static_cast<uint32_t>(calendar.tm_mon + 1), date.month);
+        ASSERT_EQ(static_cast<uint32_t>(calendar.tm_mday), date.day);
+        ASSERT_EQ(static_cast<uint32_t>(calendar.tm_yday + 1), DayOfYear(date));
+        std::tm midday = calendar;
+        midday.tm_hour = 12;
+        ASSERT_EQ(epochDay, UtcTimeFromCalendar(midday) / 86400);
+        ASSERT_EQ(epochDay, DaysFromCivil(date));
+    }
+}
+
+TEST(CivilDate, ParseDate)
+{
+    CivilDate date = {};
+    ASSERT_TRUE(ParseDate("31.08.2018", date));
+    EXPECT_EQ((CivilDate{2018, 8, 31}), date);
+    ASSERT_TRUE(ParseDate("29.02.2020", date));
+    EXPECT_EQ((CivilDate{2020, 2, 29}), date);
+}
+
+TEST(CivilDate, ParseInvalidDate)
+{
+    CivilDate date = {2018, 8, 31};
+    for (const char* text : {"", "29.02.2019", "31.04.2018", "00.01.2018", "01.00.2018", "01.13.2018", "1.08.2018",
+                             "31-08-2018", "31.08.18", "aa.bb.cccc", "31.08.2018;03:00", "3 .08.2018"})
+    {
+        EXPECT_FALSE(ParseDate(text, date)) << text;
+    }
+    EXPECT_EQ((CivilDate{2018, 8, 31}), date);
+}
+
+TEST(CivilDate, FormatDate)
+{
+    EXPECT_EQ("31.08.2018", FormatDate(CivilDate{2018, 8, 31}));
+    EXPECT_EQ("01.01.0005", FormatDate(CivilDate{5, 1, 1}));
+    CivilDate date = {};
+    ASSERT_TRUE(ParseDate(FormatDate(CivilDate{1996, 2, 29}), date));
+    EXPECT_EQ((CivilDate{1996, 2, 29}), date);
+}
+
+TEST(CivilDate, BatchMatchesScalar)
+{
+    std::vector<int32_t> epochDays;
+    for (int32_t epochDay = -800000; epochDay < 800000; ++epochDay)
+    {
+        epochDays.push_back(epochDay);
+    }
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int32_t> anyDay(s_minEpochDay, s_maxEpochDay);
+    for (int i = 0; i < 1000000; ++i)
+    {
+        epochDays.push_back(anyDay(random));
+    }
+    epochDays.push_back(s_minEpochDay);
+    epochDays.push_back(s_maxEpochDay);
+
+    const size_t count = epochDays.size();
+    std::vector<int32_t> years(count);
+    std::vector<uint8_t> months(count);
+    std::vector<uint8_t> days(count);
+    CivilFromDaysBatch(epochDays.data(), count, years.data(), months.data(), days.data());
+    for (size_t i = 0; i < count; ++i)
+    {
+        const CivilDate date = CivilFromDays(epochDays[i]);
+        ASSERT_EQ(date, (CivilDate{years[i], months[i], days[i]})) << epochDays[i];
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(CivilDate, DISABLED_Benchmark)
+{
+    const size_t count = 4 * 1024 * 1024;
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int32_t> modernDay(DaysFromCivil(CivilDate{1900, 1, 1}), DaysFromCivil(CivilDate{2100, 1, 1}));
+    std::vector<int32_t> epochDays(count);
+    for (int32_t& epochDay : epochDays)
+    {
+        epochDay = modernDay(random);
+    }
+    std::vector<CivilDate> dates(count);
+    std::vector<std::tm> calendars(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        dates[i] = CivilFromDays(epochDays[i]);
+        calendars[i] = UtcCalendarFromTime(static_cast<std::time_t>(epochDays[i]) * 86400);
+    }
+
+    auto measure = [count](const char* name, auto convert)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        const int64_t checksum = convert();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": " << seconds * 1e9 / count << " ns per date, checksum " << checksum << std::endl;
+    };
+
+    measure("DaysFromCivil", [&]()
+    {
+        int64_t checksum = 0;
+        for (const CivilDate& date : dates)
+        {
+            checksum += DaysFromCivil(date);
+        }
+        return checksum;
+    });
+    measure("timegm", [&]()
+    {
+        int64_t checksum = 0;
+        for (std::tm calendar : calendars)
+        {
+            checksum += UtcTimeFromCalendar(calendar) / 86400;
+        }
+        return checksum;
+    });
+    measure("mktime", [&]()
+    {
+        int64_t checksum = 0;
+        for (std::tm calendar : calendars)
+        {
+            calendar.tm_isdst = -1;
+            checksum += std::mktime(&calendar) / 86400;
+        }
+        return checksum;
+    });
+
+    std::vector<int32_t> years(count);
+    std::vector<uint8_t> months(count);
+    std::vector<uint8_t> days(count);
+    auto checksumDates = [&]()
+    {
+        int64_t checksum = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            checksum += years[i] + months[i] + days[i];
+        }
+        return checksum;
+    };
+    measure("CivilFromDays", [&]()
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const CivilDate date = CivilFromDays(epochDays[i]);
+            years[i] = date.year;
+            months[i] = static_cast<uint8_t>(date.month);
+            days[i] = static_cast<uint8_t>(date.day);
+        }
+        return years[count - 1];
+    });
+    std::cout << "checksum " << checksumDates() << std::endl;
+    measure("CivilFromDaysBatch", [&]()
+    {
+        CivilFromDaysBatch(epochDays.data(), count, years.data(), months.data(), days.data());
+        return years[count - 1];
+    });
+    std::cout << "checksum " << checksumDates() << std::endl;
+    measure("gmtime", [&]()
+    {
+        int64_t checksum = 0;
+        for (int32_t epochDay : epochDays)
+        {
+            const std::tm calendar = UtcCalendarFromTime(static_cast<std::time_t>(epochDay) * 86400);
+            checksum += calendar.tm_year + 1900 + calendar.tm_mon + 1 + calendar.tm_mday;
+        }
+        return checksum;
+    });
+}
@@ -16,3 +16,633 @@ The last place in a ternary number is the 1's place. The second to last is the 3
 
 If your language provides a method in the standard library to perform the conversion, pretend it doesn't exist and implement it yourself.
 */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SSE2 is baseline on x86-64 only, 32-bit builds use it when the compiler targets it.
+// Define TERNARY_NO_SSE2 to build and test the scalar code on x86.
+#if !defined(TERNARY_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TERNARY_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Architecture:
+ * Leading zeros are skipped first, they don't change the value.
+ * 3^40 is the largest power of 3 below 2^64, so up to 40 significant digits never overflow
+ * and 41 digits are checked once at the top digit, longer numbers always overflow.
+ * Digits are accumulated by Horner scheme over blocks: 16 chars are validated with one SSE2 comparison
+ * and converted to two 8-digit values by pmaddwd with weights 3^7..3^0, the value is multiplied
+ * by 3^16 per block. The first block is padded with leading zeros, so at most 3 blocks are done.
+ * Without SSE2 digits are accumulated by 4 with one multiplication by 3^4,
+ * invalid digits are collected into a flag instead of branching per char.
+*/
+
+static const size_t s_maxSafeTernaryDigits = 40;
+static const uint64_t s_ternaryPower40 = 12157665459056928801ull; // 3^40
+
+#ifdef TERNARY_SSE2
+// Value of 16 ternary digits, false if any of chars is not a ternary digit
+inline bool TernaryBlock(const char* text, uint64_t& block)
+{
+    const __m128i digits = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text)), _mm_set1_epi8('0'));
+    // Bytes below '0' wrap around and are above 2 too
+    const __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(2)), digits);
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+    {
+        return false;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(2187, 729, 243, 81, 27, 9, 3, 1);
+    const __m128i high = _mm_madd_epi16(_mm_unpacklo_epi8(digits, zero), weights);
+    const __m128i low = _mm_madd_epi16(_mm_unpackhi_epi8(digits, zero), weights);
+    // Lane 0 gets the sum of high lanes and lane 2 gets the sum of low lanes
+    const __m128i pairs = _mm_add_epi32(_mm_unpacklo_epi64(high, low), _mm_unpackhi_epi64(high, low));
+    const __m128i sums = _mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)));
+    block = static_cast<uint64_t>(_mm_cvtsi128_si32(sums)) * 6561 + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+    return true;
+}
+#endif
+
+// Horner scheme for at most 40 digits
+inline bool AccumulateTernary(std::string_view digits, uint64_t& value)
+{
+#ifdef TERNARY_SSE2
+    // The first block is padded by leading zeros, so there is no loop over single digits
+    size_t pos = digits.size() % 16;
+    if (pos != 0)
+    {
+        char padded[16];
+        std::memset(padded, '0', sizeof(padded));
+        std::memcpy(padded + sizeof(padded) - pos, digits.data(), pos);
+        if (!TernaryBlock(padded, value))
+        {
+            return false;
+        }
+    }
+    for (; pos < digits.size(); pos += 16)
+    {
+        uint64_t block = 0;
+        if (!TernaryBlock(digits.data() + pos, block))
+        {
+            return false;
+        }
+        value = value * 43046721 + block; // 3^16
+    }
+    return true;
+#else
+    size_t pos = 0;
+    unsigned invalid = 0;
+    for (; pos + 4 <= digits.size(); pos += 4)
+    {
+        const unsigned d0 = static_cast<unsigned char>(digits[pos]) - '0';
+        const unsigned d1 = static_cast<unsigned char>(digits[pos + 1]) - '0';
+        const unsigned d2 = static_cast<unsigned char>(digits[pos + 2]) - '0';
+        const unsigned d3 = static_cast<unsigned char>(digits[pos + 3]) - '0';
+        invalid |= (d0 > 2) | (d1 > 2) | (d2 > 2) | (d3 > 2);
+        value = value * 81 + ((d0 * 3 + d1) * 3 + d2) * 3 + d3;
+    }
+    for (; pos < digits.size(); ++pos)
+    {
+        const unsigned digit = static_cast<unsigned char>(digits[pos]) - '0';
+        invalid |= digit > 2;
+        value = value * 3 + digit;
+    }
+    return invalid == 0;
+#endif
+}
+
+// Value of the ternary number, 0 for invalid numbers and numbers above 2^64 - 1
+uint64_t TernaryToDecimal(std::string_view text)
+{
+    const size_t start = std::min(text.find_first_not_of('0'), text.size());
+    const std::string_view digits = text.substr(start);
+    if (digits.size() <= s_maxSafeTernaryDigits)
+    {
+        uint64_t value = 0;
+        return AccumulateTernary(digits, value) ? value : 0;
+    }
+    if (digits.size() > s_maxSafeTernaryDigits + 1 || digits.front() != '1')
+    {
+        return 0;
+    }
+    uint64_t rest = 0;
+    if (!AccumulateTernary(digits.substr(1), rest) || rest > std::numeric_limits<uint64_t>::max() - s_ternaryPower40)
+    {
+        return 0;
+    }
+    return s_ternaryPower40 + rest;
+}
+
+// Calls func(line) for every newline separated line. Windows line endings are accepted too.
+template<typename Func>
+void ForEachLine(std::string_view text, Func func)
+{
+    while (!text.empty())
+    {
+        const size_t lineEnd = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, lineEnd);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        func(line);
+        text.remove_prefix(std::min(lineEnd + 1, text.size()));
+    }
+}
+
+// Values of newline separated numbers
+std::vector<uint64_t> TernaryLinesToDecimal(std::string_view text)
+{
+    std::vector<uint64_t> values;
+    ForEachLine(text, [&values](std::string_view line) { values.push_back(TernaryToDecimal(line)); });
+    return values;
+}
+
+// Char by char reference with overflow check on every step
+uint64_t TernaryToDecimalNaive(std::string_view text)
+{
+    uint64_t value = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '2')
+        {
+            return 0;
+        }
+        const uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (value > (std::numeric_limits<uint64_t>::max() - digit) / 3)
+        {
+            return 0;
+        }
+        value = value * 3 + digit;
+    }
+    return value;
+}
+
+/*
+ * Base codec:
+ * BaseCodec<Base> decodes and encodes numbers in bases 2..36, digits are 0-9 then a-z,
+ * upper case letters are decoded too. Digit values and powers of the base are built at compile time,
+ * the digit table of every base marks symbols above the base as invalid.
+ * Overflow is handled like in the ternary converter: digits below the largest power never overflow,
+ * one more digit is checked at the top digit. Digits are accumulated by 4 with one multiplication
+ * and invalid digits are collected into a flag.
+ * Encoding splits the value into chunks below 2^32, so there is one 64-bit division per chunk
+ * and the digits of a chunk use 32-bit divisions by a constant.
+ * When Base is a power of two digits are shifted and masked instead.
+*/
+
+// Largest exponent with base^exponent <= limit
+constexpr size_t MaxExponent(uint64_t base, uint64_t limit)
+{
+    size_t exponent = 0;
+    for (uint64_t power = 1; power <= limit / base; power *= base)
+    {
+        ++exponent;
+    }
+    return exponent;
+}
+
+constexpr uint64_t Power(uint64_t base, size_t exponent)
+{
+    uint64_t power = 1;
+    for (size_t i = 0; i < exponent; ++i)
+    {
+        power *= base;
+    }
+    return power;
+}
+
+static const char s_baseSymbols[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+static const uint8_t s_invalidDigit = 0x80;
+
+template<unsigned Base>
+constexpr std::array<uint8_t, 256> MakeDigitValues()
+{
+    std::array<uint8_t, 256> values {};
+    for (size_t c = 0; c < values.size(); ++c)
+    {
+        unsigned value = s_invalidDigit;
+        if (c >= '0' && c <= '9')
+        {
+            value = c - '0';
+        }
+        else if (c >= 'a' && c <= 'z')
+        {
+            value = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'Z')
+        {
+            value = c - 'A' + 10;
+        }
+        values[c] = static_cast<uint8_t>(value < Base ? value : s_invalidDigit);
+    }
+    return values;
+}
+
+template<unsigned Base, size_t Count>
+constexpr std::array<uint64_t, Count> MakePowers()
+{
+    std::array<uint64_t, Count> powers {};
+    for (size_t i = 0; i < Count; ++i)
+    {
+        powers[i] = Power(Base, i);
+    }
+    return powers;
+}
+
+template<unsigned Base>
+class BaseCodec
+{
+    static_assert(Base >= 2 && Base <= 36, "Digits are 0-9 and a-z");
+
+public:
+    static constexpr bool s_powerOfTwo = (Base & (Base - 1)) == 0;
+    // Any number of this many digits fits into 64 bits
+    static constexpr size_t s_maxSafeDigits = MaxExponent(Base, std::numeric_limits<uint64_t>::max());
+
+    // Value of the number, 0 for invalid numbers and numbers above 2^64 - 1
+    static uint64_t Decode(std::string_view text)
+    {
+        const size_t start = std::min(text.find_first_not_of('0'), text.size());
+        const std::string_view digits = text.substr(start);
+        if (digits.size() <= s_maxSafeDigits)
+        {
+            uint64_t value = 0;
+            return Accumulate(digits, value) ? value : 0;
+        }
+        if (digits.size() > s_maxSafeDigits + 1)
+        {
+            return 0;
+        }
+        const uint64_t top = s_digitValues[static_cast<unsigned char>(digits.front())];
+        uint64_t rest = 0;
+        if (top == s_invalidDigit || top > std::numeric_limits<uint64_t>::max() / s_powers.back() ||
+            !Accumulate(digits.substr(1), rest))
+        {
+            return 0;
+        }
+        const uint64_t high = top * s_powers.back();
+        return rest <= std::numeric_limits<uint64_t>::max() - high ? high + rest : 0;
+    }
+
+    static std::string Encode(uint64_t value)
+    {
+        char buffer[64];
+        char* const end = buffer + sizeof(buffer);
+        char* pos = end;
+        if constexpr (s_powerOfTwo)
+        {
+            do
+            {
+                *--pos = s_baseSymbols[value & (Base - 1)];
+                value >>= s_shift;
+            }
+            while (value != 0);
+        }
+        else
+        {
+            for (; value >= s_chunkPower; value /= s_chunkPower)
+            {
+                uint32_t chunk = static_cast<uint32_t>(value % s_chunkPower);
+                for (size_t i = 0; i < s_chunkDigits; ++i)
+                {
+                    *--pos = s_baseSymbols[chunk % Base];
+                    chunk /= Base;
+                }
+            }
+            uint32_t rest = static_cast<uint32_t>(value);
+            do
+            {
+                *--pos = s_baseSymbols[rest % Base];
+                rest /= Base;
+            }
+            while (rest != 0);
+        }
+        return std::string(pos, end);
+    }
+
+private:
+    static constexpr unsigned s_shift = MaxExponent(2, Base);
+    static constexpr size_t s_chunkDigits = MaxExponent(Base, std::numeric_limits<uint32_t>::max());
+    static constexpr uint64_t s_chunkPower = Power(Base, s_chunkDigits);
+    static constexpr std::array<uint8_t, 256> s_digitValues = MakeDigitValues<Base>();
+    static constexpr std::array<uint64_t, s_maxSafeDigits + 1> s_powers = MakePowers<Base, s_maxSafeDigits + 1>();
+
+    // Horner scheme for at most s_maxSafeDigits digits
+    static bool Accumulate(std::string_view digits, uint64_t& value)
+    {
+        const unsigned char* text = reinterpret_cast<const unsigned char*>(digits.data());
+        size_t pos = 0;
+        unsigned invalid = 0;
+        for (; pos + 4 <= digits.size(); pos += 4)
+        {
+            const unsigned d0 = s_digitValues[text[pos]];
+            const unsigned d1 = s_digitValues[text[pos + 1]];
+            const unsigned d2 = s_digitValues[text[pos + 2]];
+            const unsigned d3 = s_digitValues[text[pos + 3]];
+            invalid |= d0 | d1 | d2 | d3;
+            if constexpr (s_powerOfTwo)
+            {
+                value = value << (4 * s_shift) | d0 << (3 * s_shift) | d1 << (2 * s_shift) | d2 << s_shift | d3;
+            }
+            else
+            {
+                value = value * s_powers[4] + ((d0 * Base + d1) * Base + d2) * Base + d3;
+            }
+        }
+        for (; pos < digits.size(); ++pos)
+        {
+            const unsigned digit = s_digitValues[text[pos]];
+            invalid |= digit;
+            if constexpr (s_powerOfTwo)
+            {
+                value = value << s_shift | digit;
+            }
+            else
+            {
+                value = value * Base + digit;
+            }
+        }
+        return (invalid & s_invalidDigit) == 0;
+    }
+};
+
+TEST(TernaryToDecimal, SingleDigits)
+{
+    EXPECT_EQ(0u, TernaryToDecimal("0"));
+    EXPECT_EQ(1u, TernaryToDecimal("1"));
+    EXPECT_EQ(2u, TernaryToDecimal("2"));
+}
+
+TEST(TernaryToDecimal, SeveralDigits)
+{
+    EXPECT_EQ(3u, TernaryToDecimal("10"));
+    EXPECT_EQ(8u, TernaryToDecimal("22"));
+    EXPECT_EQ(302u, TernaryToDecimal("102012"));
+}
+
+TEST(TernaryToDecimal, Invalid)
+{
+    EXPECT_EQ(0u, TernaryToDecimal(""));
+    EXPECT_EQ(0u, TernaryToDecimal("3"));
+    EXPECT_EQ(0u, TernaryToDecimal("1a"));
+    EXPECT_EQ(0u, TernaryToDecimal(" 12"));
+    EXPECT_EQ(0u, TernaryToDecimal("10201/"));
+    EXPECT_EQ(0u, TernaryToDecimal("1020120000000000000000000000003"));
+}
+
+TEST(TernaryToDecimal, LeadingZeros)
+{
+    EXPECT_EQ(1u, TernaryToDecimal(std::string(100, '0') + "1"));
+    EXPECT_EQ(0u, TernaryToDecimal(std::string(100, '0') + "3"));
+}
+
+TEST(TernaryToDecimal, Overflow)
+{
+    EXPECT_EQ(s_ternaryPower40, TernaryToDecimal("1" + std::string(40, '0')));
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), TernaryToDecimal("11112220022122120101211020120210210211220"));
+    EXPECT_EQ(0u, TernaryToDecimal("11112220022122120101211020120210210211221"));
+    EXPECT_EQ(0u, TernaryToDecimal("2" + std::string(40, '0')));
+    EXPECT_EQ(0u, TernaryToDecimal("1" + std::string(41, '0')));
+}
+
+// Up to 49 chars, mostly ternary digits with rare invalid ones, long enough to overflow sometimes
+std::string RandomTernaryText(std::mt19937& random)
+{
+    const char symbols[] = "0000111222222222222222222222222222222223";
+    std::string text(random() % 50, '0');
+    for (char& c : text)
+    {
+        c = symbols[random() % (sizeof(symbols) - 1)];
+    }
+    return text;
+}
+
+// Sum of the values decoded from every line of the text
+template<typename Decode>
+uint64_t SumLines(std::string_view text, Decode decode)
+{
+    uint64_t sum = 0;
+    ForEachLine(text, [&sum, &decode](std::string_view line) { sum += decode(line); });
+    return sum;
+}
+
+TEST(TernaryToDecimal, MatchesNaive)
+{
+    std::mt19937 random(42);
+    for (int i = 0; i < 200000; ++i)
+    {
+        const std::string text = RandomTernaryText(random);
+        ASSERT_EQ(TernaryToDecimalNaive(text), TernaryToDecimal(text)) << text;
+    }
+}
+
+TEST(TernaryLinesToDecimal, Empty)
+{
+    EXPECT_TRUE(TernaryLinesToDecimal("").empty());
+}
+
+TEST(TernaryLinesToDecimal, SeveralLines)
+{
+    EXPECT_EQ(std::vector<uint64_t>({302, 0, 2, 0, 3}), TernaryLinesToDecimal("102012\n3\r\n2\n\n10\n"));
+}
+
+template<unsigned Base>
+void CheckBaseCodecRoundTrip()
+{
+    std::mt19937_64 random(Base);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const uint64_t value = random() >> (random() % 64);
+        const std::string text = BaseCodec<Base>::Encode(value);
+        ASSERT_EQ(value, BaseCodec<Base>::Decode(text)) << "base " << Base << ": " << text;
+    }
+}
+
+template<unsigned Base>
+void CheckBaseCodecOverflow()
+{
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    const std::string text = BaseCodec<Base>::Encode(max);
+    EXPECT_EQ(BaseCodec<Base>::s_maxSafeDigits + 1, text.size()) << "base " << Base;
+    EXPECT_EQ(max, BaseCodec<Base>::Decode(text)) << "base " << Base;
+    EXPECT_EQ(max, BaseCodec<Base>::Decode("000" + text)) << "base " << Base;
+    EXPECT_EQ(0u, BaseCodec<Base>::Decode(text + "0")) << "base " << Base;
+    if (max % Base != Base - 1)
+    {
+        std::string above = text;
+        above.back() = s_baseSymbols[max % Base + 1];
+        EXPECT_EQ(0u, BaseCodec<Base>::Decode(above)) << "base " << Base;
+    }
+}
+
+TEST(BaseCodec, Decode)
+{
+    EXPECT_EQ(302u, BaseCodec<3>::Decode("102012"));
+    EXPECT_EQ(38u, BaseCodec<5>::Decode("123"));
+    EXPECT_EQ(255u, BaseCodec<16>::Decode("ff"));
+    EXPECT_EQ(5u, BaseCodec<2>::Decode("101"));
+    EXPECT_EQ(46655u, BaseCodec<36>::Decode("zzz"));
+    EXPECT_EQ(1295u, BaseCodec<36>::Decode("00zZ"));
+}
+
+TEST(BaseCodec, DecodeInvalid)
+{
+    EXPECT_EQ(0u, BaseCodec<3>::Decode(""));
+    EXPECT_EQ(0u, BaseCodec<3>::Decode("3"));
+    EXPECT_EQ(0u, BaseCodec<5>::Decode("12345"));
+    EXPECT_EQ(0u, BaseCodec<16>::Decode("fg"));
+    EXPECT_EQ(0u, BaseCodec<16>::Decode("0x10"));
+    EXPECT_EQ(0u, BaseCodec<36>::Decode("zz-z"));
+    EXPECT_EQ(0u, BaseCodec<2>::Decode("10102"));
+}
+
+TEST(BaseCodec, Encode)
+{
+    EXPECT_EQ("0", BaseCodec<3>::Encode(0));
+    EXPECT_EQ("102012", BaseCodec<3>::Encode(302));
+    EXPECT_EQ("123", BaseCodec<5>::Encode(38));
+    EXPECT_EQ("ff", BaseCodec<16>::Encode(255));
+    EXPECT_EQ("zzz", BaseCodec<36>::Encode(46655));
+    EXPECT_EQ("3w5e11264sgsf", BaseCodec<36>::Encode(std::numeric_limits<uint64_t>::max()));
+    EXPECT_EQ(std::string(64, '1'), BaseCodec<2>::Encode(std::numeric_limits<uint64_t>::max()));
+}
+
+TEST(BaseCodec, RoundTrip)
+{
+    CheckBaseCodecRoundTrip<2>();
+    CheckBaseCodecRoundTrip<3>();
+    CheckBaseCodecRoundTrip<5>();
+    CheckBaseCodecRoundTrip<7>();
+    CheckBaseCodecRoundTrip<10>();
+    CheckBaseCodecRoundTrip<16>();
+    CheckBaseCodecRoundTrip<32>();
+    CheckBaseCodecRoundTrip<36>();
+}
+
+TEST(BaseCodec, Overflow)
+{
+    CheckBaseCodecOverflow<2>();
+    CheckBaseCodecOverflow<3>();
+    CheckBaseCodecOverflow<5>();
+    CheckBaseCodecOverflow<16>();
+    CheckBaseCodecOverflow<32>();
+    CheckBaseCodecOverflow<36>();
+}
+
+TEST(BaseCodec, MatchesTernary)
+{
+    std::mt19937 random(42);
+    for (int i = 0; i < 200000; ++i)
+    {
+        const std::string text = RandomTernaryText(random);
+        ASSERT_EQ(TernaryToDecimal(text), BaseCodec<3>::Decode(text)) << text;
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(TernaryToDecimal, DISABLED_Benchmark)
+{
+    const size_t linesCount = 4 * 1024 * 1024;
+    std::mt19937 random(42);
+    std::string text;
+    for (size_t line = 0; line < linesCount; ++line)
+    {
+        const size_t length = 1 + random() % 40;
+        for (size_t i = 0; i < length; ++i)
+        {
+            text.push_back(static_cast<char>('0' + random() % 3));
+        }
+        text.push_back('\n');
+    }
+
+    auto measure = [&text](const char* name, uint64_t (*convert)(std::string_view))
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        const uint64_t checksum = SumLines(text, convert);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << name << ": " << text.size() / seconds / 1e9 << " GB/s, checksum " << checksum << std::endl;
+    };
+
+    measure("naive", TernaryToDecimalNaive);
+    measure("blocks", TernaryToDecimal);
+
+    const auto begin = std::chrono::steady_clock::now();
+    const std::vector<uint64_t> values = TernaryLinesToDecimal(text);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "lines: " << text.size() / seconds / 1e9 << " GB/s, " << values.size() << " values" << std::endl;
+}
+
+template<unsigned Base>
+std::string EncodeLines(const std::vector<uint64_t>& values)
+{
+    std::string text;
+    for (uint64_t value : values)
+    {
+        text += BaseCodec<Base>::Encode(value);
+        text.push_back('\n');
+    }
+    return text;
+}
+
+template<unsigned Base>
+void BenchmarkBaseCodec(const std::vector<uint64_t>& values)
+{
+    const std::string text = EncodeLines<Base>(values);
+    auto begin = std::chrono::steady_clock::now();
+    const uint64_t checksum = SumLines(text, BaseCodec<Base>::Decode);
+    const double decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    begin = std::chrono::steady_clock::now();
+    size_t encodedSize = 0;
+    for (uint64_t value : values)
+    {
+        encodedSize += BaseCodec<Base>::Encode(value).size() + 1;
+    }
+    const double encodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "base " << Base << ": decode " << text.size() / decodeSeconds / 1e9 << " GB/s, "
+              << decodeSeconds / values.size() * 1e9 << " ns/number, encode "
+              << encodeSeconds / values.size() * 1e9 << " ns/number, checksum " << checksum
+              << (encodedSize == text.size() ? "" : ", size mismatch") << std::endl;
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(BaseCodec, DISABLED_Benchmark)
+{
+    const size_t valuesCount = 4 * 1024 * 1024;
+    std::mt19937_64 random(42);
+    std::vector<uint64_t> values(valuesCount);
+    for (uint64_t& value : values)
+    {
+        value = random() >> (random() % 64);
+    }
+
+    // Hand-written ternary converter on the same numbers
+    const std::string text = EncodeLines<3>(values);
+    const auto begin = std::chrono::steady_clock::now();
+    const uint64_t checksum = SumLines(text, TernaryToDecimal);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "ternary: decode " << text.size() / seconds / 1e9 << " GB/s, "
+              << seconds / values.size() * 1e9 << " ns/number, checksum " << checksum << std::endl;
+
+    BenchmarkBaseCodec<2>(values);
+    BenchmarkBaseCodec<3>(values);
+    BenchmarkBaseCodec<5>(values);
+    BenchmarkBaseCodec<10>(values);
+    BenchmarkBaseCodec<16>(values);
+    BenchmarkBaseCodec<32>(values);
+    BenchmarkBaseCodec<36>(values);
+}
@@ -17,6 +17,11 @@ ignoring any possible match beginning after pos
 
 #include <gtest/gtest.h>
 #include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
 
 // empty string
 // string shorter than wrap number
@@ -55,6 +60,134 @@ WrappedStrings WrapString(const std::string& str, size_t wrapLength)
     return result;
 }
 
+/*
+Document wrapping: a document is a sequence of paragraphs separated by one or more empty lines.
+Line breaks inside a paragraph are treated as spaces. Paragraphs are independent, so they are
+wrapped in parallel by a pool of workers and stitched back in the original order:
+lines of a paragraph are separated by '\n', paragraphs are separated by an empty line.
+*/
+
+// [begin, end) range of a paragraph inside the document
+struct Paragraph
+{
+    size_t begin;
+    size_t end;
+};
+using Paragraphs = std::vector<Paragraph>;
+
+// Workers take paragraphs in batches to keep contention on the shared counter low
+static const size_t s_paragraphsPerTask = 64;
+
+Paragraphs SplitParagraphs(const std::string& document)
+{
+    Paragraphs result;
+    size_t paragraphBegin = std::string::npos;
+    size_t paragraphEnd = 0;
+    for (size_t pos = 0; pos < document.length();)
+    {
+        size_t lineEnd = std::min(document.find('\n', pos), document.length());
+        if (lineEnd == pos)
+        {
+            if (paragraphBegin != std::string::npos)
+            {
+                result.push_back({paragraphBegin, paragraphEnd});
+                paragraphBegin = std::string::npos;
+            }
+        }
+        else
+        {
+            if (paragraphBegin == std::string::npos)
+            {
+                paragraphBegin = pos;
+            }
+            paragraphEnd = lineEnd;
+        }
+        pos = lineEnd + 1;
+    }
+
+    if (paragraphBegin != std::string::npos)
+    {
+        result.push_back({paragraphBegin, paragraphEnd});
+    }
+    return result;
+}
+
+std::string WrapParagraph(const std::string& document, const Paragraph& paragraph, size_t wrapLength)
+{
+    std::string text = document.substr(paragraph.begin, paragraph.end - paragraph.begin);
+    std::replace(text.begin(), text.end(), '\n', ' ');
+
+    std::string result;
+    for (const std::string& line : WrapString(text, wrapLength))
+    {
+        if (!result.empty())
+        {
+            result.push_back('\n');
+        }
+        result += line;
+    }
+    return result;
+}
+
+size_t DefaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::string WrapDocument(const std::string& document, size_t wrapLength, size_t threadCount = DefaultThreadCount())
+{
+    const Paragraphs paragraphs = SplitParagraphs(document);
+    std::vector<std::string> wrapped(paragraphs.size());
+
+    std::atomic<size_t> nextParagraph(0);
+    auto worker = [&]()
+    {
+        for (size_t first = nextParagraph.fetch_add(s_paragraphsPerTask);
+             first < paragraphs.size();
+             first = nextParagraph.fetch_add(s_paragraphsPerTask))
+        {
+            const size_t last = std::min(first + s_paragraphsPerTask, paragraphs.size());
+            for (size_t i = first; i < last; ++i)
+            {
+                wrapped[i] = WrapParagraph(document, paragraphs[i], wrapLength);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threadCount; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool)
+    {
+        thread.join();
+    }
+
+    size_t totalLength = 0;
+    for (const std::string& paragraph : wrapped)
+    {
+        totalLength += paragraph.length() + 2;
+    }
+
+    std::string result;
+    result.reserve(totalLength);
+    for (const std::string& paragraph : wrapped)
+    {
+        if (paragraph.empty())
+        {
+            continue;
+        }
+        if (!result.empty())
+        {
+            result += "\n\n";
+        }
+        result += paragraph;
+    }
+    return result;
+}
+
 TEST(WrapString, EmptyString)
 {
     ASSERT_EQ(WrappedStrings(), WrapString("", 25));
@@ -94,3 +227,92 @@ TEST(WrapString, StringWrappedBySeveralWhitespace)
     WrappedStrings expected = {"12", "34"};
     ASSERT_EQ(expected, WrapString("12  34", 3));
 }
+
+TEST(SplitParagraphs, EmptyDocument)
+{
+    ASSERT_TRUE(SplitParagraphs("").empty());
+}
+
+TEST(SplitParagraphs, SingleLine)
+{
+    Paragraphs paragraphs = SplitParagraphs("abc");
+    ASSERT_EQ(1u, paragraphs.size());
+    EXPECT_EQ(0u, paragraphs[0].begin);
+    EXPECT_EQ(3u, paragraphs[0].end);
+}
+
+TEST(SplitParagraphs, SeveralLinesInParagraph)
+{
+    Paragraphs paragraphs = SplitParagraphs("ab\ncd\n");
+    ASSERT_EQ(1u, paragraphs.size());
+    EXPECT_EQ(0u, paragraphs[0].begin);
+    EXPECT_EQ(5u, paragraphs[0].end);
+}
+
+TEST(SplitParagraphs, SeveralEmptyLinesBetweenParagraphs)
+{
+    Paragraphs paragraphs = SplitParagraphs("\nab\n\n\ncd\n\n");
+    ASSERT_EQ(2u, paragraphs.size());
+    EXPECT_EQ(1u, paragraphs[0].begin);
+    EXPECT_EQ(3u, paragraphs[0].end);
+    EXPECT_EQ(6u, paragraphs[1].begin);
+    EXPECT_EQ(8u, paragraphs[1].end);
+}
+
+TEST(WrapDocument, EmptyDocument)
+{
+    ASSERT_EQ("", WrapDocument("", 10));
+}
+
+TEST(WrapDocument, SingleParagraph)
+{
+    ASSERT_EQ("12\n34", WrapDocument("12 34", 3));
+}
+
+TEST(WrapDocument, LineBreakInsideParagraphIsSpace)
+{
+    ASSERT_EQ("12 34", WrapDocument("12\n34", 10));
+}
+
+TEST(WrapDocument, ParagraphsKeepOrder)
+{
+    ASSERT_EQ("12\n34\n\n56", WrapDocument("12 34\n\n\n56\n", 3, 4));
+}
+
+TEST(WrapDocument, ParallelMatchesSequential)
+{
+    std::string document;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        document += "paragraph " + std::to_string(i) + " has some words to wrap\n\n";
+    }
+    ASSERT_EQ(WrapDocument(document, 7, 1), WrapDocument(document, 7, 8));
+}
+
+// Run with --gtest_also_run_disabled_tests to see how wrapping scales with the number of threads
+TEST(WrapDocument, DISABLED_Benchmark)
+{
+    std::string document;
+    for (size_t i = 0; i < 50000; ++i)
+    {
+        for (size_t word = 0; word < 40; ++word)
+        {
+            document += "word" + std::to_string(word) + " ";
+        }
+        document += "\n\n";
+    }
+
+    double singleThreadMs = 0;
+    for (size_t threads = 1; threads <= std::max<size_t>(DefaultThreadCount(), 4); threads *= 2)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        std::string result = WrapDocument(document, 30, threads);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        if (threads == 1)
+        {
+            singleThreadMs = ms;
+        }
+        std::cout << threads << " thread(s): " << ms << " ms, speedup " << singleThreadMs / ms
+                  << ", output " << result.size() << " bytes" << std::endl;
+    }
+}